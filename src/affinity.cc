@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include "affinity.hh"
+
+#ifdef __linux__
+#	include <sched.h>
+#endif
+
+namespace {
+
+/// Liest die erste Zeile der Datei "path"; liefert einen leeren String, falls sie nicht existiert
+std::string readLine (const std::string& path) {
+	std::ifstream file (path);
+	std::string line;
+	std::getline (file, line);
+	return line;
+}
+
+}
+
+std::vector<unsigned int> usableCpus () {
+	std::vector<unsigned int> cpus;
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO (&set);
+	if (sched_getaffinity (0, sizeof (set), &set) == 0) {
+		for (unsigned int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+			if (CPU_ISSET (cpu, &set))
+				cpus.push_back (cpu);
+	}
+#endif
+	if (cpus.empty ()) {
+		// Ist die Anzahl unbekannt, wird wenigstens ein Kern angenommen
+		unsigned int count = std::max (1u, std::thread::hardware_concurrency ());
+		for (unsigned int cpu = 0; cpu < count; ++cpu)
+			cpus.push_back (cpu);
+	}
+	return cpus;
+}
+
+int usbBusNumaNode (uint8_t bus) {
+#ifdef __linux__
+	// "usbN" ist ein Link auf den Root-Hub unterhalb des PCI-Geräts des Controllers; ".." folgt dem Link
+	std::string line = readLine ("/sys/bus/usb/devices/usb" + std::to_string (bus) + "/../numa_node");
+	if (line.empty ())
+		return -1;
+	try {
+		return std::stoi (line);
+	} catch (const std::exception&) {
+		return -1;
+	}
+#else
+	static_cast<void> (bus);
+	return -1;
+#endif
+}
+
+std::vector<unsigned int> numaNodeCpus (int node) {
+	if (node < 0)
+		return {};
+	return parseCpuList (readLine ("/sys/devices/system/node/node" + std::to_string (node) + "/cpulist"));
+}
+
+std::vector<unsigned int> parseCpuList (const std::string& list) {
+	std::vector<unsigned int> cpus;
+	std::istringstream stream (list);
+	std::string range;
+	while (std::getline (stream, range, ',')) {
+		unsigned int first, last;
+		char dash;
+		std::istringstream parts (range);
+		if (!(parts >> first))
+			continue;
+		if (!(parts >> dash >> last) || dash != '-')
+			last = first;
+		for (unsigned int cpu = first; cpu <= last; ++cpu)
+			cpus.push_back (cpu);
+	}
+	std::sort (cpus.begin (), cpus.end ());
+	cpus.erase (std::unique (cpus.begin (), cpus.end ()), cpus.end ());
+	return cpus;
+}
+
+bool pinCurrentThread (unsigned int cpu) {
+#ifdef __linux__
+	if (cpu >= CPU_SETSIZE)
+		return false;
+	cpu_set_t set;
+	CPU_ZERO (&set);
+	CPU_SET (cpu, &set);
+	// Unter Linux bezieht sich 0 auf den aufrufenden Thread, nicht auf den ganzen Prozess
+	return sched_setaffinity (0, sizeof (set), &set) == 0;
+#else
+	static_cast<void> (cpu);
+	return false;
+#endif
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef AFFINITY_HH_
+#define AFFINITY_HH_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Liefert die Nummern der CPUs, auf denen der Prozess laufen darf, aufsteigend sortiert. Unter Linux wird dazu die
+ * Affinitätsmaske des Prozesses gelesen, sodass z.B. per taskset oder cgroups ausgeschlossene Kerne nicht genutzt
+ * werden; auf anderen Systemen werden die ersten std::thread::hardware_concurrency Nummern geliefert.
+ */
+std::vector<unsigned int> usableCpus ();
+
+/**
+ * Liefert den NUMA-Knoten, an dem der Host-Controller des USB-Busses Nummer "bus" hängt. Unter Linux liegt die Angabe
+ * im sysfs beim PCI-Gerät oberhalb des Root-Hubs "usbN". Liefert -1, falls sie fehlt oder das System kein NUMA hat.
+ */
+int usbBusNumaNode (uint8_t bus);
+
+/// Liefert die CPUs des NUMA-Knotens "node" laut sysfs, aufsteigend sortiert; leer, falls unbekannt
+std::vector<unsigned int> numaNodeCpus (int node);
+
+/// Wandelt eine CPU-Liste im Format des Kernels, z.B. "0-3,8,10-11", in die einzelnen Nummern um
+std::vector<unsigned int> parseCpuList (const std::string& list);
+
+/**
+ * Bindet den aufrufenden Thread an die CPU "cpu", sodass der Scheduler ihn nicht mehr zwischen den Kernen
+ * verschiebt. Liefert false, falls das nicht möglich ist oder das System es nicht unterstützt.
+ */
+bool pinCurrentThread (unsigned int cpu);
+
+#endif /* AFFINITY_HH_ */
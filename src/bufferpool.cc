@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdlib>
+#include <new>
+#include "bufferpool.hh"
+
+#ifdef _WIN32
+#	include <malloc.h>
+#	include <windows.h>
+#else
+#	include <unistd.h>
+#endif
+
+namespace {
+
+/// Fragt die Seitengröße des Systems ab
+size_t pageSize () {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo (&info);
+	return info.dwPageSize;
+#else
+	long res = sysconf (_SC_PAGESIZE);
+	return res > 0 ? static_cast<size_t> (res) : 4096;
+#endif
+}
+
+/// Alloziert an "alignment" ausgerichteten Heap-Speicher, liefert bei Fehler nullptr
+void* alignedAlloc (size_t size, size_t alignment) {
+#ifdef _WIN32
+	return _aligned_malloc (size, alignment);
+#else
+	void* res;
+	return posix_memalign (&res, alignment, size) == 0 ? res : nullptr;
+#endif
+}
+
+/// Gibt per alignedAlloc allozierten Speicher frei
+void alignedFree (void* ptr) {
+#ifdef _WIN32
+	_aligned_free (ptr);
+#else
+	free (ptr);
+#endif
+}
+
+}
+
+BufferPool::BufferPool (libusb_device_handle* handle, size_t bufferSize, size_t count)
+	: m_handle (handle), m_bufferSize (bufferSize), m_memory (nullptr), m_memorySize (0), m_deviceMemory (false) {
+
+	// Jeder Puffer beginnt an einer Seitengrenze
+	const size_t page = pageSize ();
+	const size_t stride = (bufferSize + page - 1) / page * page;
+	m_memorySize = stride * count;
+
+	// Versuche zuerst, direkt vom Kernel nutzbaren Speicher zu bekommen; ohne Handle (simuliertes Gerät) gibt es den nicht
+	if (handle)
+		m_memory = libusb_dev_mem_alloc (handle, m_memorySize);
+	m_deviceMemory = m_memory != nullptr;
+	if (!m_deviceMemory) {
+		m_memory = static_cast<unsigned char*> (alignedAlloc (m_memorySize, page));
+		if (!m_memory)
+			throw std::bad_alloc ();
+	}
+
+	m_free.reserve (count);
+	// Lege die Puffer in umgekehrter Reihenfolge ab, damit acquire sie aufsteigend vergibt
+	for (size_t i = count; i-- > 0; )
+		m_free.push_back (m_memory + i * stride);
+}
+
+BufferPool::~BufferPool () {
+	if (m_deviceMemory)
+		libusb_dev_mem_free (m_handle, m_memory, m_memorySize);
+	else
+		alignedFree (m_memory);
+}
+
+unsigned char* BufferPool::acquire () {
+	if (m_free.empty ())
+		return nullptr;
+	unsigned char* res = m_free.back ();
+	m_free.pop_back ();
+	return res;
+}
+
+void BufferPool::release (unsigned char* buffer) {
+	m_free.push_back (buffer);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BUFFERPOOL_HH_
+#define BUFFERPOOL_HH_
+
+#include <cstddef>
+#include <vector>
+#include "libusb.h"
+
+/**
+ * Stellt eine feste Anzahl gleich großer Puffer für Bulk-Transfers bereit. Wenn möglich liegen die Puffer in
+ * per libusb_dev_mem_alloc angefordertem Speicher, den der Kernel (unter Linux via usbfs) direkt für die
+ * Übertragung nutzt, sodass keine Kopie pro Transfer nötig ist. Ist das nicht möglich, z.B. weil das System
+ * es nicht unterstützt oder das usbfs-Speicherlimit erreicht ist, wird an Seitengrenzen ausgerichteter
+ * Heap-Speicher genutzt. Alle Puffer liegen in einem zusammenhängenden Bereich, der im Konstruktor einmalig
+ * angefordert wird; die Freigabe muss vor dem Schließen des Handles erfolgen. Ist "handle" nullptr, wird immer
+ * Heap-Speicher genutzt.
+ */
+class BufferPool {
+	public:
+		BufferPool (libusb_device_handle* handle, size_t bufferSize, size_t count);
+		~BufferPool ();
+
+		BufferPool (const BufferPool&) = delete;
+		BufferPool& operator = (const BufferPool&) = delete;
+
+		/// Entnimmt einen freien Puffer. Sind alle vergeben, wird nullptr geliefert.
+		unsigned char* acquire ();
+		/// Gibt einen per acquire entnommenen Puffer zurück
+		void release (unsigned char* buffer);
+
+		/// Die Größe jedes einzelnen Puffers
+		size_t bufferSize () const { return m_bufferSize; }
+		/// Gibt an, ob die Puffer im Kernel gemappt sind (libusb_dev_mem_alloc) oder auf dem Heap liegen
+		bool deviceMemory () const { return m_deviceMemory; }
+	private:
+		libusb_device_handle* const m_handle;
+		const size_t m_bufferSize;
+		/// Der gesamte Speicherbereich aller Puffer
+		unsigned char* m_memory;
+		size_t m_memorySize;
+		bool m_deviceMemory;
+		/// Die gerade nicht vergebenen Puffer
+		std::vector<unsigned char*> m_free;
+};
+
+#endif /* BUFFERPOOL_HH_ */
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdexcept>
+#include "device.hh"
+#include "eventloop.hh"
+
+LibusbDevice::LibusbDevice (libusb_context* ctx, DevPtr handle, const libusb_device_descriptor& desc, const EndpointTable& endpoints,
+							UsbEventLoop* sharedEvents)
+	: m_ctx (ctx), m_handle (std::move (handle)), m_events (sharedEvents), m_descriptor (desc), m_endpoints (endpoints) {}
+
+LibusbDevice::~LibusbDevice () = default;
+
+int LibusbDevice::stringDescriptor (uint8_t index, unsigned char* data, int length) {
+	return libusb_get_string_descriptor_ascii (m_handle.get (), index, data, length);
+}
+
+int LibusbDevice::controlTransfer (uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, unsigned char* data, uint16_t length,
+									unsigned int timeout) {
+	return libusb_control_transfer (m_handle.get (), requestType, request, value, index, data, length, timeout);
+}
+
+int LibusbDevice::bulkTransfer (uint8_t endpoint, unsigned char* data, int length, int& transferred, unsigned int timeout) {
+	return libusb_bulk_transfer (m_handle.get (), endpoint, data, length, &transferred, timeout);
+}
+
+void LibusbDevice::startEventHandling () {
+	if (!m_events) {
+		m_ownEvents.reset (new UsbEventLoop (m_ctx));
+		m_events = m_ownEvents.get ();
+	}
+}
+
+int LibusbDevice::submit (libusb_transfer* transfer) {
+	return libusb_submit_transfer (transfer);
+}
+
+void LibusbDevice::check () const {
+	if (m_events)
+		m_events->check ();
+}
+
+std::unique_ptr<Device> openLibusbDevice (libusb_context* ctx, std::ostream& out, const DeviceSelector& selector) {
+	libusb_device_descriptor desc {};
+	EndpointTable endpoints;
+	DevPtr handle = openDevice (ctx, desc, endpoints, out, selector);
+	return std::unique_ptr<Device> (new LibusbDevice (ctx, std::move (handle), desc, endpoints));
+}
+
+std::unique_ptr<Device> openLibusbDevice (libusb_context* ctx, libusb_device* device, UsbEventLoop* sharedEvents) {
+	libusb_device_descriptor desc {};
+	lu_err (libusb_get_device_descriptor (device, &desc), "Konnte Geräte-Deskriptor nicht abfragen: ");
+	EndpointTable endpoints;
+	DevPtr handle = openDevice (ctx, device, endpoints);
+	return std::unique_ptr<Device> (new LibusbDevice (ctx, std::move (handle), desc, endpoints, sharedEvents));
+}
+
+std::vector<std::unique_ptr<Device>> openAllLibusbDevices (libusb_context* ctx, UsbEventLoop& sharedEvents, std::ostream& out, const DeviceSelector& selector) {
+	std::vector<DevRefPtr> found = findDevices (ctx, out, selector);
+	if (found.empty ())
+		throw std::runtime_error ("Kein passendes USB-Gerät gefunden.");
+	std::vector<std::unique_ptr<Device>> devices;
+	devices.reserve (found.size ());
+	for (const DevRefPtr& device : found)
+		devices.push_back (openLibusbDevice (ctx, device.get (), &sharedEvents));
+	return devices;
+}
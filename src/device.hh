@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef DEVICE_HH_
+#define DEVICE_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+#include "libusb.h"
+#include "usb.hh"
+
+class UsbEventLoop;
+
+/**
+ * Die Schnittstelle zu einem f1usb-Gerät, über die alle Übertragungen laufen. Neben dem echten Gerät per libusb
+ * (LibusbDevice) gibt es ein simuliertes (SimDevice), sodass sich der Host-seitige Ablauf auch ohne angeschlossene
+ * Hardware ausführen und messen lässt. Die Funktionen entsprechen den gleichnamigen von libusb, einschließlich der
+ * Fehlercodes (LIBUSB_ERROR_*) und der Struktur libusb_transfer für asynchrone Transfers.
+ */
+class Device {
+	public:
+		virtual ~Device () = default;
+
+		/// Kurze Bezeichnung der Implementierung für die Ausgabe, z.B. "libusb"
+		virtual const char* backend () const = 0;
+		/// Der Geräte-Deskriptor
+		virtual const libusb_device_descriptor& descriptor () const = 0;
+		/// Die Endpoints der aktiven Konfiguration
+		virtual const EndpointTable& endpoints () const = 0;
+		/// Das libusb-Handle zum Ausfüllen von Transfers und zum Allozieren von Puffern; nullptr, wenn das Gerät nicht über libusb angesprochen wird
+		virtual libusb_device_handle* handle () const = 0;
+
+		/// Wie libusb_get_string_descriptor_ascii: Schreibt den String-Deskriptor "index" nach "data" und liefert dessen Länge
+		virtual int stringDescriptor (uint8_t index, unsigned char* data, int length) = 0;
+		/// Wie libusb_control_transfer: Liefert die Anzahl übertragener Bytes oder einen Fehlercode
+		virtual int controlTransfer (uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, unsigned char* data, uint16_t length,
+										unsigned int timeout) = 0;
+		/// Wie libusb_bulk_transfer: Liefert 0 oder einen Fehlercode, die Anzahl übertragener Bytes landet in "transferred"
+		virtual int bulkTransfer (uint8_t endpoint, unsigned char* data, int length, int& transferred, unsigned int timeout) = 0;
+
+		/**
+		 * Startet die Verarbeitung asynchroner Transfers, falls noch nicht geschehen. Danach werden die Callbacks der per submit
+		 * abgeschickten Transfers in einem eigenen Thread aufgerufen.
+		 */
+		virtual void startEventHandling () = 0;
+		/// Wie libusb_submit_transfer; "transfer" muss vorher mit handle () ausgefüllt worden sein
+		virtual int submit (libusb_transfer* transfer) = 0;
+		/// Löst eine Exception aus, falls die Verarbeitung asynchroner Transfers wegen eines Fehlers beendet wurde
+		virtual void check () const = 0;
+};
+
+/**
+ * Ein per libusb geöffnetes Gerät. Die asynchronen Transfers werden von einer UsbEventLoop verarbeitet, die erst bei
+ * Bedarf gestartet wird; alternativ kann eine vorhandene übergeben werden, die sich dann mehrere Geräte desselben
+ * Kontexts teilen. Das Gerät gehört zum übergebenen Kontext, der ebenso wie eine übergebene UsbEventLoop länger als
+ * das Objekt bestehen muss.
+ */
+class LibusbDevice : public Device {
+	public:
+		LibusbDevice (libusb_context* ctx, DevPtr handle, const libusb_device_descriptor& desc, const EndpointTable& endpoints,
+						UsbEventLoop* sharedEvents = nullptr);
+		~LibusbDevice ();
+
+		const char* backend () const override { return "libusb"; }
+		const libusb_device_descriptor& descriptor () const override { return m_descriptor; }
+		const EndpointTable& endpoints () const override { return m_endpoints; }
+		libusb_device_handle* handle () const override { return m_handle.get (); }
+
+		int stringDescriptor (uint8_t index, unsigned char* data, int length) override;
+		int controlTransfer (uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, unsigned char* data, uint16_t length,
+								unsigned int timeout) override;
+		int bulkTransfer (uint8_t endpoint, unsigned char* data, int length, int& transferred, unsigned int timeout) override;
+
+		void startEventHandling () override;
+		int submit (libusb_transfer* transfer) override;
+		void check () const override;
+	private:
+		libusb_context* const m_ctx;
+		DevPtr m_handle;
+		/// Die eigene Event-Verarbeitung, falls keine gemeinsame übergeben wurde; wird vor dem Handle zerstört
+		std::unique_ptr<UsbEventLoop> m_ownEvents;
+		/// Die genutzte Event-Verarbeitung, d.h. die gemeinsame oder m_ownEvents; nullptr, solange nicht gestartet
+		UsbEventLoop* m_events;
+		const libusb_device_descriptor m_descriptor;
+		const EndpointTable m_endpoints;
+};
+
+/**
+ * Öffnet das erste zu "selector" passende Gerät per openDevice und liefert es als LibusbDevice. Die Liste der
+ * angeschlossenen Geräte wird auf "out" ausgegeben.
+ */
+std::unique_ptr<Device> openLibusbDevice (libusb_context* ctx, std::ostream& out, const DeviceSelector& selector = DeviceSelector {});
+
+/**
+ * Öffnet das gegebene Gerät, z.B. nach einem Hotplug-Ereignis, und liefert es als LibusbDevice. Ist "sharedEvents"
+ * angegeben, werden die asynchronen Transfers von dieser UsbEventLoop verarbeitet.
+ */
+std::unique_ptr<Device> openLibusbDevice (libusb_context* ctx, libusb_device* device, UsbEventLoop* sharedEvents = nullptr);
+
+/**
+ * Öffnet alle angeschlossenen, zu "selector" passenden Geräte als LibusbDevice, deren asynchrone Transfers alle von
+ * "sharedEvents" verarbeitet werden. Die Liste der angeschlossenen Geräte wird auf "out" ausgegeben. Ist keins
+ * angeschlossen oder lässt sich eins nicht öffnen, wird eine Exception ausgelöst.
+ */
+std::vector<std::unique_ptr<Device>> openAllLibusbDevices (libusb_context* ctx, UsbEventLoop& sharedEvents, std::ostream& out,
+		const DeviceSelector& selector = DeviceSelector {});
+
+#endif /* DEVICE_HH_ */
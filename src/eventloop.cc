@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "eventloop.hh"
+#include "usb.hh"
+
+UsbEventLoop::UsbEventLoop (libusb_context* ctx) : m_ctx (ctx), m_stop (false), m_error (LIBUSB_SUCCESS) {
+	m_thread = std::thread (&UsbEventLoop::run, this);
+}
+
+UsbEventLoop::~UsbEventLoop () {
+	m_stop = true;
+	// Wecke den Thread auf, falls er gerade auf Events wartet
+	libusb_interrupt_event_handler (m_ctx);
+	m_thread.join ();
+}
+
+void UsbEventLoop::check () const {
+	// Baue die Fehlermeldung nur im Fehlerfall zusammen, da check im Streaming-Pfad ständig aufgerufen wird
+	int error = m_error.load ();
+	if (error < 0)
+		lu_err (error, "Event-Verarbeitung fehlgeschlagen: ");
+}
+
+void UsbEventLoop::run () {
+	while (!m_stop) {
+		// Der Timeout begrenzt nur die Zeit bis zum Beenden, falls die Unterbrechung verpasst wurde
+		timeval tv { 0, 100000 };
+		int res = libusb_handle_events_timeout_completed (m_ctx, &tv, nullptr);
+		if (res < 0 && res != LIBUSB_ERROR_INTERRUPTED) {
+			m_error = res;
+			return;
+		}
+	}
+}
+
+CompletionQueue::CompletionQueue (size_t capacity, void (*notify) (void*), void* notifyArg)
+	: m_queue (capacity), m_waiting (false), m_producers (0), m_notify (notify), m_notifyArg (notifyArg) {
+	m_pushLock.clear ();
+}
+
+CompletionQueue::~CompletionQueue () {
+	waitForProducers ();
+}
+
+void CompletionQueue::push (libusb_transfer* transfer) {
+	// Muss gezählt werden, bevor der Transfer sichtbar wird, da der Worker danach die Warteschlange zerstören darf
+	m_producers.fetch_add (1);
+	while (m_pushLock.test_and_set (std::memory_order_acquire))
+		;
+	// Die Kapazität reicht für alle ausstehenden Transfers, daher sollte die Warteschlange nie voll sein
+	while (!m_queue.push (transfer))
+		std::this_thread::yield ();
+	m_pushLock.clear (std::memory_order_release);
+
+	// Stelle sicher, dass der Worker entweder den neuen Transfer sieht, oder hier als wartend erkannt wird
+	std::atomic_thread_fence (std::memory_order_seq_cst);
+	if (m_waiting.load (std::memory_order_relaxed)) {
+		std::lock_guard<std::mutex> lock (m_mutex);
+		m_cond.notify_one ();
+	}
+	if (m_notify)
+		m_notify (m_notifyArg);
+	// Danach darf nicht mehr auf die Warteschlange zugegriffen werden
+	m_producers.fetch_sub (1, std::memory_order_release);
+}
+
+void CompletionQueue::waitForProducers () const {
+	while (m_producers.load (std::memory_order_acquire) != 0)
+		std::this_thread::yield ();
+}
+
+libusb_transfer* CompletionQueue::pop (std::chrono::milliseconds timeout) {
+	libusb_transfer* transfer = nullptr;
+	// Im Normalfall liegt schon ein Transfer bereit, dann wird kein Lock benötigt
+	if (m_queue.pop (transfer))
+		return transfer;
+
+	std::unique_lock<std::mutex> lock (m_mutex);
+	m_waiting.store (true, std::memory_order_relaxed);
+	std::atomic_thread_fence (std::memory_order_seq_cst);
+	m_cond.wait_for (lock, timeout, [&] () { return m_queue.pop (transfer); });
+	m_waiting.store (false, std::memory_order_relaxed);
+	return transfer;
+}
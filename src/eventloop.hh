@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EVENTLOOP_HH_
+#define EVENTLOOP_HH_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "libusb.h"
+#include "spscqueue.hh"
+
+/**
+ * Besitzt einen Thread, der fortlaufend die Events des gegebenen libusb-Kontexts abarbeitet, sodass
+ * Transfer-Callbacks unabhängig davon ausgeführt werden, was die übrigen Threads gerade tun. Der Thread
+ * wird im Konstruktor gestartet und im Destruktor beendet; der Kontext muss so lange gültig bleiben.
+ */
+class UsbEventLoop {
+	public:
+		explicit UsbEventLoop (libusb_context* ctx);
+		~UsbEventLoop ();
+
+		UsbEventLoop (const UsbEventLoop&) = delete;
+		UsbEventLoop& operator = (const UsbEventLoop&) = delete;
+
+		/// Der Kontext, dessen Events abgearbeitet werden
+		libusb_context* context () const { return m_ctx; }
+
+		/// Löst eine Exception aus, falls der Event-Thread wegen eines Fehlers beendet wurde
+		void check () const;
+	private:
+		void run ();
+
+		libusb_context* const m_ctx;
+		/// Wird zum Beenden des Threads gesetzt
+		std::atomic<bool> m_stop;
+		/// Fehler-Code von libusb_handle_events_timeout_completed, falls der Thread deswegen beendet wurde
+		std::atomic<int> m_error;
+		std::thread m_thread;
+};
+
+/**
+ * Übergibt abgeschlossene Transfers vom Event-Thread an genau einen Worker-Thread. Die Transfer-Callbacks
+ * rufen push auf, der Worker holt die Transfers mit pop ab und wertet sie aus. Intern wird eine lock-freie
+ * SpscQueue genutzt; nur wenn sie leer ist, legt sich der Worker über eine Condition Variable schlafen.
+ * Die Kapazität muss mindestens der Anzahl gleichzeitig ausstehender Transfers entsprechen.
+ */
+class CompletionQueue {
+	public:
+		/**
+		 * Legt die Warteschlange für bis zu "capacity" Transfers an. Ist "notify" gegeben, wird es nach jedem push mit
+		 * "notifyArg" aufgerufen, z.B. um den Empfänger als Aufgabe in einem TaskPool einzuplanen.
+		 */
+		explicit CompletionQueue (size_t capacity, void (*notify) (void*) = nullptr, void* notifyArg = nullptr);
+		/// Wartet per waitForProducers, bis kein Thread mehr in push ist
+		~CompletionQueue ();
+
+		CompletionQueue (const CompletionQueue&) = delete;
+		CompletionQueue& operator = (const CompletionQueue&) = delete;
+
+		/**
+		 * Reiht einen abgeschlossenen Transfer ein. Wird aus den Callbacks aufgerufen, also normalerweise im
+		 * Event-Thread. Da libusb Callbacks aber auch in einem Thread ausführen kann, der gerade eine synchrone
+		 * Funktion aufruft und dabei kurz die Event-Verarbeitung übernimmt, ist die schreibende Seite durch
+		 * ein (praktisch nie umkämpftes) Spinlock abgesichert.
+		 */
+		void push (libusb_transfer* transfer);
+
+		/// Entnimmt den nächsten abgeschlossenen Transfer und wartet dazu höchstens "timeout". Liefert bei Timeout nullptr.
+		libusb_transfer* pop (std::chrono::milliseconds timeout);
+
+		/// Prüft, ob die Warteschlange leer ist. Darf nur vom Empfänger aufgerufen werden.
+		bool empty () const { return m_queue.empty (); }
+
+		/**
+		 * Wartet, bis kein Thread mehr in push ist. Sobald der Worker den letzten Transfer entnommen hat, kann push im
+		 * Event-Thread noch den Worker wecken bzw. "notify" aufrufen; bevor die Warteschlange oder das Objekt, das
+		 * "notify" erreicht, zerstört wird, muss daher hiermit darauf gewartet werden. Wartet nur kurz, da push nie blockiert.
+		 */
+		void waitForProducers () const;
+	private:
+		SpscQueue<libusb_transfer*> m_queue;
+		/// Spinlock für die schreibende Seite
+		std::atomic_flag m_pushLock;
+		/// Ist gesetzt, solange der Worker auf m_cond wartet
+		std::atomic<bool> m_waiting;
+		/// Anzahl der Threads, die gerade in push sind
+		std::atomic<unsigned int> m_producers;
+		std::mutex m_mutex;
+		std::condition_variable m_cond;
+		/// Wird nach jedem push aufgerufen, falls gegeben
+		void (*const m_notify) (void*);
+		void* const m_notifyArg;
+};
+
+#endif /* EVENTLOOP_HH_ */
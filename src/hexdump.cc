@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstring>
+#include "hexdump.hh"
+
+namespace {
+
+/// Anzahl Zeichen pro Byte in der Ausgabe: zwei Hex-Ziffern, Komma und Leerzeichen
+constexpr size_t charsPerByte = 4;
+
+/// Die Darstellung aller 256 Bytes, jeweils als "xx, "
+struct HexTable {
+	char text [256 * charsPerByte];
+};
+
+constexpr HexTable makeHexTable () {
+	HexTable table {};
+	const char digits [] = "0123456789abcdef";
+	for (unsigned int i = 0; i < 256; ++i) {
+		table.text [i * charsPerByte] = digits [i >> 4];
+		table.text [i * charsPerByte + 1] = digits [i & 0xF];
+		table.text [i * charsPerByte + 2] = ',';
+		table.text [i * charsPerByte + 3] = ' ';
+	}
+	return table;
+}
+
+/// Die zur Compile-Zeit berechnete Tabelle
+constexpr HexTable hexTable = makeHexTable ();
+
+}
+
+HexDump::HexDump (size_t capacity) {
+	m_text.reserve (64 + capacity * charsPerByte);
+}
+
+void HexDump::write (std::ostream& os, const char* label, const unsigned char* data, size_t length) {
+	const size_t labelLength = std::strlen (label);
+	// Ändert die Größe nur, wenn der Puffer wachsen muss; danach wird jedes Zeichen überschrieben
+	m_text.resize (labelLength + length * charsPerByte + 1);
+	char* out = &m_text [0];
+
+	std::memcpy (out, label, labelLength);
+	out += labelLength;
+	for (size_t i = 0; i < length; ++i, out += charsPerByte)
+		std::memcpy (out, hexTable.text + data [i] * charsPerByte, charsPerByte);
+	*out = '\n';
+
+	os.write (m_text.data (), static_cast<std::streamsize> (m_text.size ()));
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HEXDUMP_HH_
+#define HEXDUMP_HH_
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+/**
+ * Formatiert Puffer als Folge von Hex-Bytes der Form "de, c8, 1d, " für die Ausgabe auf der Konsole.
+ * Jedes Byte wird per Tabelle in zwei Zeichen umgewandelt, statt über die Manipulatoren von std::ostream;
+ * der Text wird in einem wiederverwendeten Puffer zusammengesetzt und mit einem einzigen write ausgegeben.
+ */
+class HexDump {
+	public:
+		/// Reserviert Platz für Puffer bis zur Größe "capacity", sodass später keine Allokationen nötig sind
+		explicit HexDump (size_t capacity = 0);
+
+		/**
+		 * Gibt "label" gefolgt von den "length" Bytes aus "data" und einem Zeilenumbruch auf "os" aus.
+		 * Der Stream wird nicht geleert, damit die Ausgabe großer Puffer nicht in viele Teile zerfällt.
+		 */
+		void write (std::ostream& os, const char* label, const unsigned char* data, size_t length);
+	private:
+		std::string m_text;
+};
+
+#endif /* HEXDUMP_HH_ */
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "histogram.hh"
+
+#ifdef _MSC_VER
+#	include <intrin.h>
+#endif
+
+namespace {
+
+/// Position des höchsten gesetzten Bits; "value" darf nicht 0 sein
+inline unsigned int highestBit (uint64_t value) {
+#ifdef _MSC_VER
+	// _BitScanReverse64 gibt es nur für 64-Bit-Ziele, daher werden die Hälften einzeln betrachtet
+	unsigned long index;
+	if (_BitScanReverse (&index, static_cast<unsigned long> (value >> 32)))
+		return static_cast<unsigned int> (index) + 32;
+	_BitScanReverse (&index, static_cast<unsigned long> (value));
+	return static_cast<unsigned int> (index);
+#else
+	return 63 - static_cast<unsigned int> (__builtin_clzll (value));
+#endif
+}
+
+/// Formatiert Nanosekunden als Mikrosekunden
+void formatMicros (char* buffer, size_t size, uint64_t nanoseconds) {
+	std::snprintf (buffer, size, "%.1f", static_cast<double> (nanoseconds) / 1e3);
+}
+
+}
+
+constexpr unsigned int LatencyHistogram::subBits;
+constexpr size_t LatencyHistogram::subBuckets;
+constexpr size_t LatencyHistogram::bucketCount;
+
+LatencyHistogram::LatencyHistogram () : m_count (0), m_max (0) {
+	for (auto& bucket : m_buckets)
+		bucket.store (0, std::memory_order_relaxed);
+}
+
+size_t LatencyHistogram::bucketIndex (uint64_t value) {
+	// Kleine Werte werden exakt erfasst
+	if (value < subBuckets)
+		return static_cast<size_t> (value);
+	// Ab 2^subBits bestimmen die subBits Bits nach dem höchsten gesetzten Bit die Klasse innerhalb des Bereichs
+	unsigned int shift = highestBit (value) - subBits;
+	return subBuckets + shift * subBuckets + static_cast<size_t> ((value >> shift) - subBuckets);
+}
+
+uint64_t LatencyHistogram::bucketLow (size_t index) {
+	if (index < subBuckets)
+		return index;
+	size_t shift = index / subBuckets - 1;
+	return (uint64_t { subBuckets } + index % subBuckets) << shift;
+}
+
+uint64_t LatencyHistogram::bucketHigh (size_t index) {
+	// Die letzte Klasse reicht bis zum größten darstellbaren Wert
+	return index + 1 < bucketCount ? bucketLow (index + 1) - 1 : UINT64_MAX;
+}
+
+void LatencyHistogram::record (uint64_t nanoseconds) {
+	m_buckets [bucketIndex (nanoseconds)].fetch_add (1, std::memory_order_relaxed);
+	m_count.fetch_add (1, std::memory_order_relaxed);
+	uint64_t max = m_max.load (std::memory_order_relaxed);
+	while (nanoseconds > max && !m_max.compare_exchange_weak (max, nanoseconds, std::memory_order_relaxed))
+		;
+}
+
+uint64_t LatencyHistogram::percentile (double quantile) const {
+	const uint64_t total = count ();
+	if (total == 0)
+		return 0;
+	// Anzahl Werte, die höchstens so groß sein müssen wie das Ergebnis
+	const uint64_t rank = std::max<uint64_t> (1, static_cast<uint64_t> (std::ceil (quantile * static_cast<double> (total))));
+	uint64_t seen = 0;
+	for (size_t i = 0; i < bucketCount; ++i) {
+		seen += m_buckets [i].load (std::memory_order_relaxed);
+		if (seen >= rank)
+			return std::min (bucketHigh (i), max ());
+	}
+	return max ();
+}
+
+void LatencyHistogram::printSummary (std::ostream& os, const char* name) const {
+	char p50 [32], p90 [32], p99 [32], p999 [32], pmax [32];
+	formatMicros (p50, sizeof (p50), percentile (0.5));
+	formatMicros (p90, sizeof (p90), percentile (0.9));
+	formatMicros (p99, sizeof (p99), percentile (0.99));
+	formatMicros (p999, sizeof (p999), percentile (0.999));
+	formatMicros (pmax, sizeof (pmax), max ());
+
+	os	<< "Latenz " << name << " (" << count () << " Messungen, µs): p50 " << p50 << ", p90 " << p90 << ", p99 " << p99
+		<< ", p99.9 " << p999 << ", max " << pmax << "\n";
+}
+
+void LatencyHistogram::printBuckets (std::ostream& os, const char* name) const {
+	const uint64_t total = count ();
+	os << "Histogramm " << name << " (von ns, bis ns, Anzahl, kumulierter Anteil):\n";
+	uint64_t seen = 0;
+	for (size_t i = 0; i < bucketCount; ++i) {
+		uint64_t n = m_buckets [i].load (std::memory_order_relaxed);
+		if (n == 0)
+			continue;
+		seen += n;
+		char line [128];
+		std::snprintf (line, sizeof (line), "%14llu %14llu %10llu %9.5f\n", static_cast<unsigned long long> (bucketLow (i)),
+				static_cast<unsigned long long> (bucketHigh (i)), static_cast<unsigned long long> (n), static_cast<double> (seen) / static_cast<double> (total));
+		os << line;
+	}
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HISTOGRAM_HH_
+#define HISTOGRAM_HH_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * Ein Histogramm für Latenzen in Nanosekunden mit log-linearer Einteilung nach dem Vorbild von HdrHistogram:
+ * Jeder Zweierpotenz-Bereich ist in subBuckets gleich breite Klassen unterteilt, sodass jeder Wert mit einem
+ * relativen Fehler von höchstens 1/subBuckets (ca. 3%) erfasst wird, egal ob er im Bereich von Mikrosekunden
+ * oder Sekunden liegt. Der Speicherbedarf ist fest; record ist lock-frei und darf aus beliebigen Threads
+ * gleichzeitig aufgerufen werden.
+ */
+class LatencyHistogram {
+	public:
+		/// Anzahl Bits für die Unterteilung jedes Zweierpotenz-Bereichs
+		static constexpr unsigned int subBits = 5;
+		/// Anzahl Klassen pro Zweierpotenz-Bereich
+		static constexpr size_t subBuckets = size_t { 1 } << subBits;
+		/// Gesamtzahl Klassen, genug für alle 64-Bit-Werte
+		static constexpr size_t bucketCount = subBuckets + (64 - subBits) * subBuckets;
+
+		LatencyHistogram ();
+
+		LatencyHistogram (const LatencyHistogram&) = delete;
+		LatencyHistogram& operator = (const LatencyHistogram&) = delete;
+
+		/// Erfasst einen Wert in Nanosekunden
+		void record (uint64_t nanoseconds);
+		/// Erfasst eine Dauer
+		template <typename Rep, typename Period>
+		void record (std::chrono::duration<Rep, Period> duration) {
+			auto ns = std::chrono::duration_cast<std::chrono::nanoseconds> (duration).count ();
+			record (static_cast<uint64_t> (ns < 0 ? 0 : ns));
+		}
+
+		/// Anzahl erfasster Werte
+		uint64_t count () const { return m_count.load (std::memory_order_relaxed); }
+		/// Größter erfasster Wert
+		uint64_t max () const { return m_max.load (std::memory_order_relaxed); }
+		/**
+		 * Liefert den Wert, unter dem der Anteil "quantile" (0 bis 1) aller erfassten Werte liegt. Das Ergebnis ist die
+		 * Obergrenze der entsprechenden Klasse, aber höchstens der größte erfasste Wert.
+		 */
+		uint64_t percentile (double quantile) const;
+
+		/// Gibt "name", die Anzahl, p50/p90/p99/p99.9 und das Maximum in einer Zeile aus
+		void printSummary (std::ostream& os, const char* name) const;
+		/// Gibt alle belegten Klassen mit Grenzen, Anzahl und kumuliertem Anteil aus
+		void printBuckets (std::ostream& os, const char* name) const;
+	private:
+		static size_t bucketIndex (uint64_t value);
+		static uint64_t bucketLow (size_t index);
+		static uint64_t bucketHigh (size_t index);
+
+		std::atomic<uint64_t> m_buckets [bucketCount];
+		std::atomic<uint64_t> m_count;
+		std::atomic<uint64_t> m_max;
+};
+
+#endif /* HISTOGRAM_HH_ */
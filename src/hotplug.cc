@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdexcept>
+#include "hotplug.hh"
+
+HotplugMonitor::HotplugMonitor (libusb_context* ctx, uint16_t vendorId, uint16_t productId) : m_ctx (ctx), m_handle () {
+	if (!libusb_has_capability (LIBUSB_CAP_HAS_HOTPLUG))
+		throw std::runtime_error ("libusb unterstützt auf diesem System kein Hotplug.");
+	// Mit LIBUSB_HOTPLUG_ENUMERATE wird der Callback schon hier für alle angeschlossenen Geräte aufgerufen
+	lu_err (libusb_hotplug_register_callback (ctx, static_cast<libusb_hotplug_event> (LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+								LIBUSB_HOTPLUG_ENUMERATE, vendorId, productId, LIBUSB_HOTPLUG_MATCH_ANY, callback, this, &m_handle),
+			"Konnte Hotplug-Callback nicht registrieren: ");
+}
+
+HotplugMonitor::~HotplugMonitor () {
+	libusb_hotplug_deregister_callback (m_ctx, m_handle);
+}
+
+int LIBUSB_CALL HotplugMonitor::callback (libusb_context*, libusb_device* device, libusb_hotplug_event event, void* userData) {
+	HotplugMonitor* self = static_cast<HotplugMonitor*> (userData);
+	std::lock_guard<std::mutex> lock (self->m_mutex);
+	self->m_events.push_back (HotplugEvent { DevRefPtr (libusb_ref_device (device)), event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED });
+	// Bleibe registriert
+	return 0;
+}
+
+bool HotplugMonitor::pop (HotplugEvent& event) {
+	std::lock_guard<std::mutex> lock (m_mutex);
+	if (m_events.empty ())
+		return false;
+	event = std::move (m_events.front ());
+	m_events.pop_front ();
+	return true;
+}
+
+bool HotplugMonitor::next (HotplugEvent& event, std::chrono::milliseconds timeout) {
+	if (pop (event))
+		return true;
+	// Arbeite die Events ab, bis der Callback etwas eingereiht hat oder die Zeit abgelaufen ist
+	const auto end = std::chrono::steady_clock::now () + timeout;
+	for (auto now = std::chrono::steady_clock::now (); now < end; now = std::chrono::steady_clock::now ()) {
+		const auto remaining = std::chrono::duration_cast<std::chrono::microseconds> (end - now).count ();
+		timeval tv { static_cast<decltype (tv.tv_sec)> (remaining / 1000000), static_cast<decltype (tv.tv_usec)> (remaining % 1000000) };
+		int res = libusb_handle_events_timeout_completed (m_ctx, &tv, nullptr);
+		if (res != LIBUSB_ERROR_INTERRUPTED)
+			lu_err (res, "Event-Verarbeitung fehlgeschlagen: ");
+		if (pop (event))
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef HOTPLUG_HH_
+#define HOTPLUG_HH_
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include "libusb.h"
+#include "usb.hh"
+
+/// Ein Hotplug-Ereignis: Ein Gerät wurde angeschlossen oder entfernt
+struct HotplugEvent {
+	/// Das Gerät; die Referenz bleibt bis zur Freigabe des Ereignisses gültig
+	DevRefPtr device;
+	/// true, wenn das Gerät angeschlossen, false, wenn es entfernt wurde
+	bool arrived;
+};
+
+/**
+ * Meldet per libusb_hotplug_register_callback das Anschließen und Entfernen von Geräten mit der gegebenen VID und PID,
+ * ohne die Liste aller Geräte wiederholt abzufragen. Bereits angeschlossene Geräte werden zu Beginn als angeschlossen
+ * gemeldet. Der Callback läuft in dem Thread, der gerade die libusb-Events abarbeitet, und reiht die Ereignisse nur ein,
+ * da darin keine synchronen Transfers erlaubt sind; abgeholt werden sie per next. Unterstützt die Plattform kein Hotplug,
+ * löst der Konstruktor eine Exception aus.
+ */
+class HotplugMonitor {
+	public:
+		HotplugMonitor (libusb_context* ctx, uint16_t vendorId, uint16_t productId);
+		~HotplugMonitor ();
+
+		HotplugMonitor (const HotplugMonitor&) = delete;
+		HotplugMonitor& operator = (const HotplugMonitor&) = delete;
+
+		/**
+		 * Liefert das nächste Ereignis in "event". Liegt keins vor, werden bis zu "timeout" lang die libusb-Events
+		 * abgearbeitet; kommt in dieser Zeit keins, wird false geliefert.
+		 */
+		bool next (HotplugEvent& event, std::chrono::milliseconds timeout);
+	private:
+		static int LIBUSB_CALL callback (libusb_context* ctx, libusb_device* device, libusb_hotplug_event event, void* userData);
+
+		bool pop (HotplugEvent& event);
+
+		libusb_context* const m_ctx;
+		libusb_hotplug_callback_handle m_handle;
+		/// Schützt m_events, da der Callback auch von einem anderen Thread aus aufgerufen werden kann
+		std::mutex m_mutex;
+		std::deque<HotplugEvent> m_events;
+};
+
+#endif /* HOTPLUG_HH_ */
@@ -0,0 +1,427 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include "kernels.hh"
+#include "reverse.hh"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#	define KERNELS_X86 1
+#	include <immintrin.h>
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#	else
+#		include <cpuid.h>
+#	endif
+#endif
+
+#if defined(KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+	// GCC und Clang erzeugen Code für erweiterte Befehlssätze nur in explizit dafür markierten Funktionen
+#	define KERNEL_TARGET(t) __attribute__ ((target (t)))
+#else
+	// MSVC erlaubt die Nutzung aller Intrinsics ohne weitere Angaben
+#	define KERNEL_TARGET(t)
+#endif
+
+namespace {
+
+/// Skalare Prüfung, verarbeitet 8 Bytes auf einmal (siehe reverse.hh)
+bool verifyScalar (const unsigned char* tx, const unsigned char* rx, size_t length) {
+	return verifyReversed (tx, rx, length);
+}
+
+/// Skalares Umdrehen, verarbeitet 8 Bytes auf einmal
+void reverseScalar (const unsigned char* src, unsigned char* dst, size_t length) {
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8) {
+		uint64_t word;
+		std::memcpy (&word, src + i, 8);
+		word = reverseBytewise (word);
+		std::memcpy (dst + i, &word, 8);
+	}
+	for (; i < length; ++i)
+		dst [i] = reverse (src [i]);
+}
+
+/// Die Tabellen für die CRC-32C nach dem "Slicing-by-8"-Verfahren
+struct Crc32cTable {
+	uint32_t values [8][256];
+};
+
+/// Erzeugt die Crc32cTable zur Compile-Zeit für das (bitweise umgekehrte) Castagnoli-Polynom 0x82F63B78
+constexpr Crc32cTable makeCrc32cTable () {
+	Crc32cTable table {};
+	for (unsigned int i = 0; i < 256; ++i) {
+		uint32_t crc = i;
+		for (unsigned int bit = 0; bit < 8; ++bit)
+			crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78u : 0);
+		table.values [0][i] = crc;
+	}
+	// Tabelle k liefert den Beitrag eines Bytes, auf das noch k weitere Bytes folgen
+	for (unsigned int k = 1; k < 8; ++k)
+		for (unsigned int i = 0; i < 256; ++i)
+			table.values [k][i] = (table.values [k-1][i] >> 8) ^ table.values [0][table.values [k-1][i] & 0xFF];
+	return table;
+}
+
+constexpr Crc32cTable crc32cTable = makeCrc32cTable ();
+
+/// Skalare CRC-32C ohne Vor- und Nachinvertierung, verarbeitet 8 Bytes auf einmal
+uint32_t crc32cScalar (uint32_t crc, const unsigned char* data, size_t length) {
+	const auto& t = crc32cTable.values;
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8) {
+		// Die Bytes werden einzeln zusammengesetzt, damit das Ergebnis nicht von der Byte-Reihenfolge abhängt
+		const uint32_t lo = crc ^ (uint32_t { data [i] } | (uint32_t { data [i+1] } << 8) | (uint32_t { data [i+2] } << 16) | (uint32_t { data [i+3] } << 24));
+		crc =	t [7][lo & 0xFF] ^ t [6][(lo >> 8) & 0xFF] ^ t [5][(lo >> 16) & 0xFF] ^ t [4][lo >> 24]
+			^	t [3][data [i+4]] ^ t [2][data [i+5]] ^ t [1][data [i+6]] ^ t [0][data [i+7]];
+	}
+	for (; i < length; ++i)
+		crc = (crc >> 8) ^ t [0][(crc ^ data [i]) & 0xFF];
+	return crc;
+}
+
+#ifdef KERNELS_X86
+
+/// CRC-32C per SSE4.2-Befehl crc32 ohne Vor- und Nachinvertierung, verarbeitet 8 Bytes auf einmal
+KERNEL_TARGET ("sse4.2")
+uint32_t crc32cSse42 (uint32_t crc, const unsigned char* data, size_t length) {
+	size_t i = 0;
+#if defined(__x86_64__) || defined(_M_X64)
+	uint64_t crc64 = crc;
+	for (; i + 8 <= length; i += 8) {
+		uint64_t word;
+		std::memcpy (&word, data + i, 8);
+		crc64 = _mm_crc32_u64 (crc64, word);
+	}
+	crc = static_cast<uint32_t> (crc64);
+#endif
+	for (; i + 4 <= length; i += 4) {
+		uint32_t word;
+		std::memcpy (&word, data + i, 4);
+		crc = _mm_crc32_u32 (crc, word);
+	}
+	for (; i < length; ++i)
+		crc = _mm_crc32_u8 (crc, data [i]);
+	return crc;
+}
+
+/*
+ * Bei SSSE3 und AVX2 wird jedes Byte in zwei Nibbles zerlegt, die per pshufb in einer 16-Einträge-Tabelle
+ * nachgeschlagen werden: das umgedrehte untere Nibble wird zum oberen, das umgedrehte obere zum unteren.
+ */
+
+/// Die umgedrehten Nibbles, für das untere Nibble eines Bytes (Ergebnis im oberen Nibble)
+#define KERNEL_LUT_LO	static_cast<char> (0x00), static_cast<char> (0x80), static_cast<char> (0x40), static_cast<char> (0xC0), \
+						static_cast<char> (0x20), static_cast<char> (0xA0), static_cast<char> (0x60), static_cast<char> (0xE0), \
+						static_cast<char> (0x10), static_cast<char> (0x90), static_cast<char> (0x50), static_cast<char> (0xD0), \
+						static_cast<char> (0x30), static_cast<char> (0xB0), static_cast<char> (0x70), static_cast<char> (0xF0)
+/// Die umgedrehten Nibbles, für das obere Nibble eines Bytes (Ergebnis im unteren Nibble)
+#define KERNEL_LUT_HI	0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE, 0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF
+
+KERNEL_TARGET ("ssse3")
+inline __m128i reverseSsse3 (__m128i val) {
+	const __m128i lutLo = _mm_setr_epi8 (KERNEL_LUT_LO), lutHi = _mm_setr_epi8 (KERNEL_LUT_HI), mask = _mm_set1_epi8 (0x0F);
+	__m128i lo = _mm_and_si128 (val, mask);
+	__m128i hi = _mm_and_si128 (_mm_srli_epi16 (val, 4), mask);
+	return _mm_or_si128 (_mm_shuffle_epi8 (lutLo, lo), _mm_shuffle_epi8 (lutHi, hi));
+}
+
+KERNEL_TARGET ("ssse3")
+bool verifySsse3 (const unsigned char* tx, const unsigned char* rx, size_t length) {
+	size_t i = 0;
+	for (; i + 16 <= length; i += 16) {
+		__m128i diff = _mm_xor_si128 (reverseSsse3 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (tx + i))), _mm_loadu_si128 (reinterpret_cast<const __m128i*> (rx + i)));
+		if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (diff, _mm_setzero_si128 ())) != 0xFFFF)
+			return false;
+	}
+	return verifyReversed (tx + i, rx + i, length - i);
+}
+
+KERNEL_TARGET ("ssse3")
+void reverseBufferSsse3 (const unsigned char* src, unsigned char* dst, size_t length) {
+	size_t i = 0;
+	for (; i + 16 <= length; i += 16)
+		_mm_storeu_si128 (reinterpret_cast<__m128i*> (dst + i), reverseSsse3 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (src + i))));
+	reverseScalar (src + i, dst + i, length - i);
+}
+
+KERNEL_TARGET ("avx2")
+inline __m256i reverseAvx2 (__m256i val) {
+	// pshufb arbeitet getrennt in beiden 128-Bit-Hälften, daher steht die Tabelle in beiden
+	const __m256i lutLo = _mm256_setr_epi8 (KERNEL_LUT_LO, KERNEL_LUT_LO), lutHi = _mm256_setr_epi8 (KERNEL_LUT_HI, KERNEL_LUT_HI), mask = _mm256_set1_epi8 (0x0F);
+	__m256i lo = _mm256_and_si256 (val, mask);
+	__m256i hi = _mm256_and_si256 (_mm256_srli_epi16 (val, 4), mask);
+	return _mm256_or_si256 (_mm256_shuffle_epi8 (lutLo, lo), _mm256_shuffle_epi8 (lutHi, hi));
+}
+
+KERNEL_TARGET ("avx2")
+bool verifyAvx2 (const unsigned char* tx, const unsigned char* rx, size_t length) {
+	size_t i = 0;
+	for (; i + 32 <= length; i += 32) {
+		__m256i diff = _mm256_xor_si256 (reverseAvx2 (_mm256_loadu_si256 (reinterpret_cast<const __m256i*> (tx + i))), _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (rx + i)));
+		if (!_mm256_testz_si256 (diff, diff))
+			return false;
+	}
+	return verifyReversed (tx + i, rx + i, length - i);
+}
+
+KERNEL_TARGET ("avx2")
+void reverseBufferAvx2 (const unsigned char* src, unsigned char* dst, size_t length) {
+	size_t i = 0;
+	for (; i + 32 <= length; i += 32)
+		_mm256_storeu_si256 (reinterpret_cast<__m256i*> (dst + i), reverseAvx2 (_mm256_loadu_si256 (reinterpret_cast<const __m256i*> (src + i))));
+	reverseScalar (src + i, dst + i, length - i);
+}
+
+/*
+ * Mit GFNI dreht ein einziger gf2p8affineqb-Befehl die Bits aller Bytes um: Die Matrix 0x8040201008040201
+ * bildet Bit i jedes Bytes auf Bit 7-i ab.
+ */
+
+/// Matrix für gf2p8affineqb, die die Bits jedes Bytes umdreht
+constexpr long long gfniReverseMatrix = 0x8040201008040201ll;
+
+KERNEL_TARGET ("avx2,gfni")
+bool verifyAvx2Gfni (const unsigned char* tx, const unsigned char* rx, size_t length) {
+	const __m256i matrix = _mm256_set1_epi64x (gfniReverseMatrix);
+	size_t i = 0;
+	for (; i + 32 <= length; i += 32) {
+		__m256i rev = _mm256_gf2p8affine_epi64_epi8 (_mm256_loadu_si256 (reinterpret_cast<const __m256i*> (tx + i)), matrix, 0);
+		__m256i diff = _mm256_xor_si256 (rev, _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (rx + i)));
+		if (!_mm256_testz_si256 (diff, diff))
+			return false;
+	}
+	return verifyReversed (tx + i, rx + i, length - i);
+}
+
+KERNEL_TARGET ("avx2,gfni")
+void reverseBufferAvx2Gfni (const unsigned char* src, unsigned char* dst, size_t length) {
+	const __m256i matrix = _mm256_set1_epi64x (gfniReverseMatrix);
+	size_t i = 0;
+	for (; i + 32 <= length; i += 32)
+		_mm256_storeu_si256 (reinterpret_cast<__m256i*> (dst + i), _mm256_gf2p8affine_epi64_epi8 (_mm256_loadu_si256 (reinterpret_cast<const __m256i*> (src + i)), matrix, 0));
+	reverseScalar (src + i, dst + i, length - i);
+}
+
+KERNEL_TARGET ("avx512f,avx512bw,gfni")
+bool verifyAvx512Gfni (const unsigned char* tx, const unsigned char* rx, size_t length) {
+	const __m512i matrix = _mm512_set1_epi64 (gfniReverseMatrix);
+	size_t i = 0;
+	for (; i + 64 <= length; i += 64) {
+		__m512i rev = _mm512_gf2p8affine_epi64_epi8 (_mm512_loadu_si512 (tx + i), matrix, 0);
+		if (_mm512_cmpneq_epi8_mask (rev, _mm512_loadu_si512 (rx + i)) != 0)
+			return false;
+	}
+	// Den Rest erledigt ein maskierter Vergleich statt der skalaren Variante
+	if (i < length) {
+		// Hier sind weniger als 64 Bytes übrig, der Shift ist also definiert
+		__mmask64 mask = (1ull << (length - i)) - 1;
+		__m512i rev = _mm512_gf2p8affine_epi64_epi8 (_mm512_maskz_loadu_epi8 (mask, tx + i), matrix, 0);
+		if (_mm512_mask_cmpneq_epi8_mask (mask, rev, _mm512_maskz_loadu_epi8 (mask, rx + i)) != 0)
+			return false;
+	}
+	return true;
+}
+
+KERNEL_TARGET ("avx512f,avx512bw,gfni")
+void reverseBufferAvx512Gfni (const unsigned char* src, unsigned char* dst, size_t length) {
+	const __m512i matrix = _mm512_set1_epi64 (gfniReverseMatrix);
+	size_t i = 0;
+	for (; i + 64 <= length; i += 64)
+		_mm512_storeu_si512 (dst + i, _mm512_gf2p8affine_epi64_epi8 (_mm512_loadu_si512 (src + i), matrix, 0));
+	reverseScalar (src + i, dst + i, length - i);
+}
+
+/// Führt den CPUID-Befehl aus; "regs" erhält EAX, EBX, ECX, EDX
+void cpuid (unsigned int leaf, unsigned int subleaf, unsigned int regs [4]) {
+#ifdef _MSC_VER
+	int r [4];
+	__cpuidex (r, static_cast<int> (leaf), static_cast<int> (subleaf));
+	for (int i = 0; i < 4; ++i)
+		regs [i] = static_cast<unsigned int> (r [i]);
+#else
+	__cpuid_count (leaf, subleaf, regs [0], regs [1], regs [2], regs [3]);
+#endif
+}
+
+/// Liest das Register XCR0, welches angibt, welche Register-Zustände das Betriebssystem sichert
+KERNEL_TARGET ("xsave")
+uint64_t xgetbv0 () {
+#ifdef _MSC_VER
+	return _xgetbv (0);
+#else
+	unsigned int eax, edx;
+	__asm__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+	return (uint64_t { edx } << 32) | eax;
+#endif
+}
+
+/// Von der CPU und dem Betriebssystem unterstützte Befehlssätze
+struct CpuFeatures {
+	bool ssse3, sse42, avx2, avx512bw, gfni;
+};
+
+CpuFeatures detectCpu () {
+	CpuFeatures res {};
+	unsigned int regs [4];
+	cpuid (0, 0, regs);
+	const unsigned int maxLeaf = regs [0];
+
+	cpuid (1, 0, regs);
+	res.ssse3 = (regs [2] >> 9) & 1;
+	res.sse42 = (regs [2] >> 20) & 1;
+	// Ohne OSXSAVE dürfen die AVX-Register nicht genutzt werden
+	const bool osxsave = (regs [2] >> 27) & 1;
+	const uint64_t xcr0 = osxsave ? xgetbv0 () : 0;
+	// SSE- und AVX-Zustand bzw. zusätzlich die drei AVX-512-Zustände
+	const bool osAvx = (xcr0 & 0x6) == 0x6;
+	const bool osAvx512 = (xcr0 & 0xE6) == 0xE6;
+
+	if (maxLeaf >= 7) {
+		cpuid (7, 0, regs);
+		res.avx2 = osAvx && ((regs [1] >> 5) & 1);
+		res.avx512bw = osAvx512 && ((regs [1] >> 16) & 1) && ((regs [1] >> 30) & 1);
+		res.gfni = (regs [2] >> 8) & 1;
+	}
+	return res;
+}
+
+/// Die Befehlssätze dieser CPU, einmalig ermittelt
+const CpuFeatures& cpuFeatures () {
+	static const CpuFeatures cpu = detectCpu ();
+	return cpu;
+}
+
+#endif
+
+/// Alle Varianten, die schnellste zuerst
+const ReverseKernels allKernels [] = {
+#ifdef KERNELS_X86
+	{ "avx512-gfni", verifyAvx512Gfni, reverseBufferAvx512Gfni },
+	{ "avx2-gfni", verifyAvx2Gfni, reverseBufferAvx2Gfni },
+	{ "avx2", verifyAvx2, reverseBufferAvx2 },
+	{ "ssse3", verifySsse3, reverseBufferSsse3 },
+#endif
+	{ "scalar", verifyScalar, reverseScalar }
+};
+
+/// Prüft, ob die CPU die gegebene Variante unterstützt
+bool supported (const ReverseKernels& kernels) {
+#ifdef KERNELS_X86
+	const CpuFeatures& cpu = cpuFeatures ();
+	const std::string name = kernels.name;
+	if (name == "avx512-gfni")
+		return cpu.avx512bw && cpu.gfni;
+	if (name == "avx2-gfni")
+		return cpu.avx2 && cpu.gfni;
+	if (name == "avx2")
+		return cpu.avx2;
+	if (name == "ssse3")
+		return cpu.ssse3;
+#endif
+	return true;
+}
+
+/// Die ausgewählte Variante; nullptr bis zur ersten Auswahl
+std::atomic<const ReverseKernels*> selected { nullptr };
+
+/// Eine Implementierung der CRC-32C
+struct Crc32cKernel {
+	const char* name;
+	uint32_t (*update) (uint32_t crc, const unsigned char* data, size_t length);
+};
+
+/// Wählt die schnellste auf dieser CPU verfügbare Implementierung der CRC-32C
+const Crc32cKernel& crc32cKernel () {
+#ifdef KERNELS_X86
+	static const Crc32cKernel sse42 { "sse4.2", crc32cSse42 };
+	if (cpuFeatures ().sse42)
+		return sse42;
+#endif
+	static const Crc32cKernel scalar { "scalar", crc32cScalar };
+	return scalar;
+}
+
+/// Größe der Abschnitte, in denen crc32cReversed die umgedrehten Daten auf dem Stack zwischenspeichert
+constexpr size_t crc32cChunk = 4096;
+
+}
+
+const ReverseKernels& reverseKernels () {
+	const ReverseKernels* res = selected.load (std::memory_order_acquire);
+	if (!res) {
+		// Wähle die erste (schnellste) unterstützte Variante. Laufen mehrere Threads gleichzeitig hier hinein, wählen alle dieselbe.
+		for (const ReverseKernels& kernels : allKernels) {
+			if (supported (kernels)) {
+				res = &kernels;
+				break;
+			}
+		}
+		selected.store (res, std::memory_order_release);
+	}
+	return *res;
+}
+
+void selectReverseKernels (const std::string& name) {
+	for (const ReverseKernels& kernels : allKernels) {
+		if (name == kernels.name) {
+			if (!supported (kernels))
+				throw std::runtime_error ("Kernel wird von dieser CPU nicht unterstützt: " + name);
+			selected.store (&kernels, std::memory_order_release);
+			return;
+		}
+	}
+	throw std::runtime_error ("Unbekannter Kernel: " + name);
+}
+
+std::vector<std::string> availableReverseKernels () {
+	std::vector<std::string> res;
+	for (const ReverseKernels& kernels : allKernels)
+		if (supported (kernels))
+			res.push_back (kernels.name);
+	return res;
+}
+
+uint32_t crc32c (uint32_t crc, const unsigned char* data, size_t length) {
+	static const Crc32cKernel& kernel = crc32cKernel ();
+	return ~kernel.update (~crc, data, length);
+}
+
+uint32_t crc32cReversed (uint32_t crc, const unsigned char* data, size_t length) {
+	static const Crc32cKernel& kernel = crc32cKernel ();
+	const ReverseKernels& kernels = reverseKernels ();
+	unsigned char buffer [crc32cChunk];
+	crc = ~crc;
+	for (size_t offset = 0; offset < length; offset += crc32cChunk) {
+		const size_t chunk = std::min (crc32cChunk, length - offset);
+		kernels.reverse (data + offset, buffer, chunk);
+		crc = kernel.update (crc, buffer, chunk);
+	}
+	return ~crc;
+}
+
+const char* crc32cImplementation () {
+	return crc32cKernel ().name;
+}
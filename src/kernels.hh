@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef KERNELS_HH_
+#define KERNELS_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Ein Satz von Funktionen ("Kernel") zum Umdrehen der Bits in jedem Byte ganzer Puffer. Es gibt eine skalare
+ * Variante, die überall funktioniert, und auf x86 mit SIMD-Befehlen arbeitende Varianten, von denen zur
+ * Laufzeit per CPUID die schnellste von der CPU unterstützte ausgewählt wird.
+ */
+struct ReverseKernels {
+	/// Kurzer Name zur Auswahl per Kommandozeile und zur Ausgabe, z.B. "avx2"
+	const char* name;
+	/// Prüft, ob jedes der "length" Bytes in "rx" dem umgedrehten Byte an derselben Stelle in "tx" entspricht
+	bool (*verify) (const unsigned char* tx, const unsigned char* rx, size_t length);
+	/// Schreibt die umgedrehten Bytes aus "src" nach "dst"; die Bereiche dürfen identisch sein, sich aber nicht anders überlappen
+	void (*reverse) (const unsigned char* src, unsigned char* dst, size_t length);
+};
+
+/**
+ * Liefert die aktuell ausgewählten Kernel. Beim ersten Aufruf wird die schnellste auf dieser CPU verfügbare
+ * Variante gewählt, sofern nicht vorher selectReverseKernels aufgerufen wurde. Kann aus beliebigen Threads
+ * aufgerufen werden.
+ */
+const ReverseKernels& reverseKernels ();
+
+/**
+ * Wählt die Kernel mit dem gegebenen Namen aus, z.B. um Varianten zu vergleichen. Ist der Name unbekannt
+ * oder wird die Variante von der CPU nicht unterstützt, wird eine Exception ausgelöst.
+ */
+void selectReverseKernels (const std::string& name);
+
+/// Liefert die Namen aller auf dieser CPU nutzbaren Kernel, die schnellste zuerst
+std::vector<std::string> availableReverseKernels ();
+
+/**
+ * Berechnet die CRC-32C (Castagnoli-Polynom, wie bei iSCSI und ext4) über "length" Bytes ab "data". Um Daten in
+ * mehreren Teilen zu verarbeiten, wird das Ergebnis des vorherigen Teils als "crc" übergeben; für den ersten Teil 0.
+ * Unterstützt die CPU SSE4.2, wird der dafür vorgesehene Befehl genutzt, sonst ein tabellenbasiertes Verfahren.
+ */
+uint32_t crc32c (uint32_t crc, const unsigned char* data, size_t length);
+
+/**
+ * Wie crc32c, aber über die Bytes aus "data" mit umgedrehten Bits, d.h. über die vom Gerät erwartete Antwort.
+ * Die umgedrehten Daten werden abschnittsweise auf dem Stack erzeugt und nicht vollständig gespeichert.
+ */
+uint32_t crc32cReversed (uint32_t crc, const unsigned char* data, size_t length);
+
+/// Name der von crc32c genutzten Implementierung, "sse4.2" oder "scalar"
+const char* crc32cImplementation ();
+
+#endif /* KERNELS_HH_ */
@@ -21,150 +21,108 @@
  
 #include <iostream>
 #include <stdexcept>
+#include <memory>
 #include <iomanip>
 #include <cstring>
-#include <random>
 #include <vector>
 #include <string>
 #include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <thread>
 #include "libusb.h"
-
-/**
- * Wird dieser Funktion ein libusb-Error Code übergeben, löst sie eine Exception mit der
- * gegebenen Fehlermeldung und den dem Code entsprechenden Informationen der LibUsb aus
- */
-template <typename Ret>
-Ret lu_err (Ret r, std::string errmsg) {
-	if (r < 0)
-		// Frage Fehlerbeschreibung der Libusb ab und baue Fehlermeldung zusammen
-		throw std::runtime_error (errmsg + libusb_error_name (static_cast<int> (r)) + " - " + libusb_strerror (static_cast<libusb_error> (r)));
-	return r;
-}
-
-/// Ein Dummy-Struct zur Freigabe des libusb context. Kann als "Deleter" in std::unique_ptr genutzt werden.
-struct ExitLibusb {
-	void operator () (libusb_context* ctx) {
-		libusb_exit (ctx);
-	}
-};
-/// Ein libusb_context welcher in diesem unique_ptr verpackt wird, wird automatisch korrekt freigegeben.
-using CtxPtr = std::unique_ptr<libusb_context, ExitLibusb>;
-
-/// Ein Dummy-Struct zur Freigabe von libusb_device* Listen. Kann als "Deleter" in std::unique_ptr genutzt werden.
-struct FreeDeviceList {
-	void operator () (libusb_device ** list) {
-		libusb_free_device_list (list, 1);
-	}
-};
-/// Eine Liste aus libusb_device* welche in diesem unique_ptr verpackt wird, wird automatisch korrekt freigegeben.
-using DevListPtr = std::unique_ptr<libusb_device* [], FreeDeviceList>;
-
-/// Ein Dummy-Struct zur Freigabe von libusb_device_handle. Kann als "Deleter" in std::unique_ptr genutzt werden.
-struct CloseDevice {
-	void operator () (libusb_device_handle* dev) {
-		libusb_close (dev);
-	}
-};
-/// Ein libusb_device_handle welcher in diesem unique_ptr verpackt wird, wird automatisch korrekt freigegeben.
-using DevPtr = std::unique_ptr<libusb_device_handle, CloseDevice>;
-
-/**
- * Sucht ein geeignetes USB-Gerät, öffnet es und gibt das entsprechende libusb-Handle zurück.
- * Außerdem wird der USB-Deskriptor in den Parameter "desc" geschrieben. Falls kein Gerät gefunden
- * wurde, wird eine Exception ausgelöst.
- */
-DevPtr openDevice (libusb_device_descriptor& desc) {
-	// Die Liste der angeschlossenen Geräte
-	libusb_device **list_raw;
-	// Frage Liste ab, libusb_get_device_list allokiert Speicher
-	ssize_t cnt = lu_err(libusb_get_device_list (nullptr, &list_raw), "Liste angeschlossener Geräte konnte nicht abgefragt werden: ");
-	
-	// Verpacke Liste in unique_ptr für automatische Freigabe
-	DevListPtr list (list_raw);
-
-	// Iteriere gefundene Geräte
-	ssize_t iFound = -1;
-	std::cout << "Angeschlossene Geräte:\n";
-	for (ssize_t i = 0; i < cnt; i++) {
-		// Das Gerät
-		libusb_device *device = list [i];
-		libusb_device_descriptor deviceDescriptor;
-		// Frage Device Descriptor ab
-		lu_err (libusb_get_device_descriptor (device, &deviceDescriptor), "Konnte Geräte-Deskriptor nicht abfragen: ");
-
-		// Gebe Adresse und VID/PID des Geräts aus
-		std::cout	<< std::dec << int { libusb_get_bus_number(device) } << ":" << int { libusb_get_port_number(device) } << ":" << int { libusb_get_device_address (device) } << " "
-					<< std::hex << std::setw(4) << std::setfill('0') << deviceDescriptor.idVendor << ":"
-					<< std::hex << std::setw(4) << std::setfill('0') << deviceDescriptor.idProduct << std::endl;
-
-		// Prüfe auf gewünschte VID+PID
-		if (iFound == -1 && deviceDescriptor.idVendor == 0xDEAD && deviceDescriptor.idProduct == 0xBEEF) {
-			// Merke Index
-			iFound = i;
-			// Merke Device-Descriptor
-			std::memcpy (&desc, &deviceDescriptor, sizeof (deviceDescriptor));
-		}
-	}
-	if (iFound == -1)
-		throw std::runtime_error ("Kein passendes USB-Gerät gefunden.");
-		
-
-	// Öffne Device
-	libusb_device_handle *handle = nullptr;
-	lu_err (libusb_open (list [iFound], &handle), "Konnte Gerät nicht öffnen: ");
-	
-	// Verpacke Handle in unique_ptr für automatische Freigabe
-	DevPtr devPtr (handle);
-
-	// Beanspruche das Interface für diese Anwendung (sendet nichts auf dem Bus)
-	lu_err (libusb_claim_interface (handle, 0), "Konnte Interface nicht öffnen: ");
-
-	return devPtr;
-}
+#include "usb.hh"
+#include "stream.hh"
+#include "device.hh"
+#include "simdevice.hh"
+#include "hotplug.hh"
+#include "affinity.hh"
+#include "taskpool.hh"
+#include "eventloop.hh"
+#include "bufferpool.hh"
+#include "kernels.hh"
+#include "options.hh"
+#include "pattern.hh"
+#include "record.hh"
+#include "hexdump.hh"
+#include "stats.hh"
+#include "histogram.hh"
+#include "mismatch.hh"
 
 /**
  * Fragt die String-Deskriptoren für iManufacturer, iProduct und iSerialNumber des Geräts ab
- * und gibt sie aus, falls vorhanden.
+ * und gibt sie auf "out" aus, falls vorhanden.
  */
-void queryStrings (libusb_device_handle* handle, libusb_device_descriptor& foundDeviceDescriptor) {
+void queryStrings (Device& device, std::ostream& out) {
+	const libusb_device_descriptor& foundDeviceDescriptor = device.descriptor ();
 	// libusb erwartet einen String-Puffer. 256 Bytes ist die Maximal-Länge bei String-Deskriptoren, und wir brauchen noch ein Zeichen mehr zum Terminieren
 	unsigned char strBuffer [257];
 	int len;
 
 	if (foundDeviceDescriptor.iManufacturer != 0) {
 		// Frage Deskriptor ab
-		len = lu_err (libusb_get_string_descriptor_ascii (handle, foundDeviceDescriptor.iManufacturer, strBuffer, sizeof (strBuffer)-1), "Konnte Hersteller-String nicht abfragen: ");
+		len = lu_err (device.stringDescriptor (foundDeviceDescriptor.iManufacturer, strBuffer, sizeof (strBuffer)-1), "Konnte Hersteller-String nicht abfragen: ");
 		// Setze terminierendes 0-Byte
 		strBuffer [len] = 0;
-		std::cout << "Manufacturer: " << strBuffer << std::endl;
+		out << "Manufacturer: " << strBuffer << std::endl;
 	}
 	if (foundDeviceDescriptor.iProduct != 0) {
 		// Frage Deskriptor ab
-		len = lu_err (libusb_get_string_descriptor_ascii (handle, foundDeviceDescriptor.iProduct, strBuffer, sizeof (strBuffer)-1), "Konnte Produkt-String nicht abfragen: ");
+		len = lu_err (device.stringDescriptor (foundDeviceDescriptor.iProduct, strBuffer, sizeof (strBuffer)-1), "Konnte Produkt-String nicht abfragen: ");
 		// Setze terminierendes 0-Byte
 		strBuffer [len] = 0;
-		std::cout << "Product: " << strBuffer << std::endl;
+		out << "Product: " << strBuffer << std::endl;
 	}
 	if (foundDeviceDescriptor.iSerialNumber != 0) {
 		// Frage Deskriptor ab
-		len = lu_err (libusb_get_string_descriptor_ascii (handle, foundDeviceDescriptor.iSerialNumber, strBuffer, sizeof (strBuffer)-1), "Konnte Seriennummer-String nicht abfragen: ");
+		len = lu_err (device.stringDescriptor (foundDeviceDescriptor.iSerialNumber, strBuffer, sizeof (strBuffer)-1), "Konnte Seriennummer-String nicht abfragen: ");
 		// Setze terminierendes 0-Byte
 		strBuffer [len] = 0;
-		std::cout << "Serial: " << strBuffer << std::endl;
+		out << "Serial: " << strBuffer << std::endl;
 	}
 }
 
 /**
- * Fragt den aktuellen Zustand der LED's ab und gibt ihn auf der Konsole aus. Wenn als
- * Parameter an das Programm zwei Zahlen übergeben wurde, werden die LED's entsprechend gesetzt
+ * Führt einen Control-Transfer aus und zeichnet ihn in "record" auf. Liefert wie libusb_control_transfer die Anzahl
+ * übertragener Bytes bzw. einen negativen Fehlercode; nur bei Erfolg wird die Dauer in "latency" erfasst.
+ */
+int controlTransfer (Device& device, uint8_t requestType, uint8_t request, uint16_t value, uint16_t index,
+						unsigned char* data, uint16_t length, LatencyHistogram& latency, RecordLog& record) {
+	const auto start = std::chrono::steady_clock::now ();
+	int res = device.controlTransfer (requestType, request, value, index, data, length, 0);
+	const auto duration = std::chrono::steady_clock::now () - start;
+	record.appendControl (requestType, request, value, index, length, res, data, start, duration);
+	if (res >= 0)
+		latency.record (duration);
+	return res;
+}
+
+/**
+ * Führt einen Bulk-Transfer über "endpoint" aus und zeichnet ihn in "record" auf. Sind die Daten die zuletzt von
+ * "source" erzeugten, wird das mit aufgezeichnet. Liefert wie libusb_bulk_transfer 0 bzw. einen negativen Fehlercode.
+ */
+int bulkTransfer (Device& device, uint8_t endpoint, unsigned char* data, size_t length, int& transferred, RecordLog& record,
+					const Pattern* source = nullptr) {
+	const auto start = std::chrono::steady_clock::now ();
+	transferred = 0;
+	int res = device.bulkTransfer (endpoint, data, static_cast<int> (length), transferred, 0);
+	record.appendBulk (endpoint, length, res, data, static_cast<size_t> (transferred), start, std::chrono::steady_clock::now () - start,
+						source, source ? source->offset () - length : 0);
+	return res;
+}
+
+/**
+ * Fragt den aktuellen Zustand der LED's ab und gibt ihn auf "out" aus. Wenn als
+ * Parameter an das Programm zwei Zahlen übergeben wurde, werden die LED's entsprechend gesetzt.
+ * Die Dauer jedes Control-Transfers wird in "latency" erfasst und jeder Control-Transfer in "record" aufgezeichnet.
  */
-void ledHandling (libusb_device_handle *handle, const std::vector<std::string>& args) {
+void ledHandling (Device& device, const std::vector<std::string>& args, std::ostream& out, LatencyHistogram& latency, RecordLog& record) {
 	// Frage aktuellen Zustand ab, empfange dazu ein 1-Byte-Paket
-	uint8_t ledData;
-	lu_err (libusb_control_transfer (handle, 0xC0, 2, 0, 0, &ledData, 1, 0), "Konnte LED-Zustand nicht abfragen: ");
+	uint8_t ledData = 0;
+	lu_err (controlTransfer (device, 0xC0, 2, 0, 0, &ledData, 1, latency, record), "Konnte LED-Zustand nicht abfragen: ");
 
 	// Extrahiere Daten aus Paket und gebe sie aus
-	std::cout << "LED1: " << int {ledData & 1} << std::endl << "LED2: " << int {(ledData & 2) >> 1} << std::endl;
+	out << "LED1: " << int {ledData & 1} << std::endl << "LED2: " << int {(ledData & 2) >> 1} << std::endl;
 
 	if (args.size () > 2) {
 		// Prüfe Kommandozeilenargumente
@@ -174,91 +132,790 @@ void ledHandling (libusb_device_handle *handle, const std::vector<std::string>&
 		ledData = static_cast<uint8_t> (uint8_t{ LED1 }  | (uint8_t{ LED2 } << 1));
 
 		// Sende Anfrage, nutze Paket für wValue
-		lu_err (libusb_control_transfer (handle, 0x40, 1, ledData, 0, nullptr, 0, 0), "Konnte LED-Zustand nicht setzen: ");
+		lu_err (controlTransfer (device, 0x40, 1, ledData, 0, nullptr, 0, latency, record), "Konnte LED-Zustand nicht setzen: ");
 	}
 }
 
 /**
- * Dreht den übergebenen Integer um.
+ * Die Puffer, die dataHandling auf einem Gerät für Blöcke der Größe "transferSize" braucht. Sie werden einmal je Gerät
+ * angelegt und von allen Wiederholungen genutzt, sodass dabei weder per libusb_dev_mem_alloc Speicher gemappt noch auf
+ * dem Heap alloziert wird. Der Platz für die Ausgabe der Blöcke wird nur reserviert, wenn "verbose" gesetzt ist.
  */
-template <typename T>
-T reverse (T val) {
-	T temp = 0;
-	// Iteriere jedes Bit
-	for (size_t i = 0; i < CHAR_BIT * sizeof (T); ++i) {
-		// Übernehme unterstes Bit der Eingabe in unterstes Bit der Ausgabe
-		temp = static_cast<T> ((temp << 1) | (val & 1));
-		// Shifte Ausgabe eins nach Links
-		val = static_cast<T> (val >> 1);
-	}
-	return temp;
-}
+struct DataBuffers {
+	DataBuffers (Device& device, size_t transferSize, bool zlp, bool verbose)
+		: pool (device.handle (), std::max (transferSize, echoInLength (transferSize, device.endpoints ().bulkIn.maxPacketSize, zlp)), 2),
+		  tx (pool.acquire ()), rx (pool.acquire ()), dump (verbose ? transferSize : 0) {}
+
+	BufferPool pool;
+	/// Sende- und Empfangspuffer
+	unsigned char* const tx;
+	unsigned char* const rx;
+	/// Zur Ausgabe beider Blöcke
+	HexDump dump;
+};
 
 /**
- * Sendet eine zufällige Byte-Folge an den Bulk-Endpoint 1, empfängt die Antwort,
- * und prüft ob sie korrekt ist, d.h. jedes Byte umgedreht wurde.
+ * Sendet eine Byte-Folge der Länge "transferSize" an den Bulk-OUT-Endpoint, empfängt die Antwort
+ * vom Bulk-IN-Endpoint, und prüft ob sie korrekt ist, d.h. jedes Byte umgedreht wurde. Ist "zlp" gesetzt,
+ * wird ein Block, dessen Länge ein Vielfaches der Paketgröße ist, mit einem Null-Paket abgeschlossen. Die Daten werden
+ * nach dem Muster "pattern" aus "seed" erzeugt und gemeinsam mit der Antwort auf "out" ausgegeben, sofern dieser einen
+ * Puffer hat (sonst werden sie gar nicht erst formatiert); das Ergebnis der
+ * Prüfung erscheint immer auf "report", bei Fehlern mit deren Position und Anzahl. Die Dauer vom Beginn des Sendens
+ * bis zum vollständigen Empfang der Antwort wird in "latency" erfasst, die Fehler werden zu "errors" hinzugefügt.
+ * Jeder einzelne Bulk-Transfer wird in "record" aufgezeichnet. "buffers" muss für dasselbe Gerät, "transferSize" und "zlp"
+ * angelegt sein.
  */
-bool dataHandling (libusb_device_handle *handle) {
-	// Puffer für beide Datenpakte, um sie vergleichen zu können
-	unsigned char txBuffer [64], rxBuffer [64];
-	// Initialisiere Pseude-Zufallszahlengenerator und nehme aktuelle Uhrzeit als Seed
-	std::mt19937 gen (static_cast<uint_fast32_t> (std::chrono::system_clock::now ().time_since_epoch ().count ()));
-	// Initialisiere uniforme Verteilung im Bereich 0-255
-	std::uniform_int_distribution<uint16_t> dist (0, 0xFF);
-	std::cout << "Sende Daten     : ";
-
-	// Fülle Sendepuffer
-	for (uint8_t& val : txBuffer) {
-		// Berechne Zufallswert
-		val = static_cast<uint8_t> (dist (gen));
-		// Gebe ihn aus und speichere ihn
-		std::cout << std::hex << std::setw (2) << std::setfill ('0') << int{ val }  << ", ";
+bool dataHandling (Device& device, size_t transferSize, bool zlp, PatternType pattern, uint64_t seed, DataBuffers& buffers,
+					std::ostream& out, std::ostream& report, LatencyHistogram& latency, ErrorStats& errors, RecordLog& record) {
+	const EndpointTable& endpoints = device.endpoints ();
+	// Puffer für beide Datenblöcke, um sie vergleichen zu können
+	const size_t rxSize = echoInLength (transferSize, endpoints.bulkIn.maxPacketSize, zlp);
+	unsigned char* txBuffer = buffers.tx;
+	unsigned char* rxBuffer = buffers.rx;
+	// Fülle Sendepuffer mit dem Anfang des Musters
+	Pattern gen (pattern, seed);
+	gen.fill (txBuffer, transferSize);
+
+	// Gebe gesendete Daten aus
+	const bool verbose = out.rdbuf () != nullptr;
+	HexDump& dump = buffers.dump;
+	if (verbose) {
+		dump.write (out, "Sende Daten     : ", txBuffer, transferSize);
+		out.flush ();
 	}
-	std::cout << std::endl;
-	// Sende Datenblock
+	// Sende Datenblock; ist er größer als ein Paket, teilt der Kernel ihn auf
+	auto start = std::chrono::steady_clock::now ();
 	int sent;
-	lu_err (libusb_bulk_transfer (handle, 1, txBuffer, sizeof (txBuffer), &sent, 0), "OUT Transfer fehlgeschlagen: ");
+	lu_err (bulkTransfer (device, endpoints.bulkOut.address, txBuffer, transferSize, sent, record, &gen), "OUT Transfer fehlgeschlagen: ");
+	// Schließe Block ggf. mit Null-Paket ab, da das letzte Paket nicht kurz war
+	if (zlp && transferSize % endpoints.bulkOut.maxPacketSize == 0)
+		lu_err (bulkTransfer (device, endpoints.bulkOut.address, txBuffer, 0, sent, record), "OUT Transfer fehlgeschlagen: ");
 
 	// Empfange antwort
-	lu_err (libusb_bulk_transfer (handle, 0x81, rxBuffer, sizeof (rxBuffer), &sent, 0), "IN Transfer fehlgeschlagen: ");
-
-	std::cout << "Empfangene Daten: ";
-	bool ok = true;
-	// Iteriere empfangenes Paket
-	for (size_t i = 0; i < sizeof (rxBuffer); ++i) {
-		// Gebe empfangenes Byte aus
-		std::cout << std::hex << std::setw (2) << std::setfill ('0') << int{ rxBuffer [i] } << ", ";
-		// Prüfe ob Byte korrekt umgedreht wurde
-		ok = ok && (rxBuffer [i] == reverse (txBuffer [i]));
+	int received;
+	lu_err (bulkTransfer (device, endpoints.bulkIn.address, rxBuffer, rxSize, received, record), "IN Transfer fehlgeschlagen: ");
+	latency.record (std::chrono::steady_clock::now () - start);
+
+	// Gebe empfangene Daten aus, aber höchstens so viele wie gesendet wurden
+	if (verbose)
+		dump.write (out, "Empfangene Daten: ", rxBuffer, std::min (static_cast<size_t> (received), transferSize));
+	// Die Antwort muss genau so lang sein wie der gesendete Block, und jedes Byte korrekt umgedreht sein
+	const size_t compared = std::min (static_cast<size_t> (received), transferSize);
+	BlockErrors blockErrors;
+	if (!reverseKernels ().verify (txBuffer, rxBuffer, compared))
+		blockErrors = analyzeReversed (txBuffer, rxBuffer, compared);
+	addLengthMismatch (blockErrors, compared, static_cast<size_t> (received) > transferSize ? static_cast<size_t> (received) - transferSize : transferSize - compared);
+	errors.add (errors.blocks, transferSize, blockErrors);
+
+	report << "Daten stimmen überein: " << std::boolalpha << blockErrors.ok () << std::endl;
+	if (!blockErrors.ok ())
+		printBlockErrors (report, blockErrors, transferSize);
+
+	return blockErrors.ok ();
+}
+
+/// Über die Kommandozeile einstellbare Optionen
+struct Options {
+	/// Nutze den asynchronen Streaming-Modus statt des einzelnen Blocks in dataHandling
+	bool stream = false;
+	/// Unterdrückt Geräteliste, Deskriptoren und Datenblöcke; im Streaming-Modus wird stattdessen jede Sekunde eine Statistik-Zeile ausgegeben
+	bool quiet = false;
+	/// Anzahl Wiederholungen von LED-Abfrage und Datenübertragung außerhalb des Streaming-Modus, z.B. für die Latenz-Messung
+	unsigned int repeat = 1;
+	/// Gebe am Ende zusätzlich zur Zusammenfassung alle Klassen der Latenz-Histogramme aus
+	bool histogram = false;
+	/// Parameter für den Streaming-Modus
+	StreamConfig streamConfig;
+	/// Datei, in der jeder Transfer außerhalb des Streaming-Modus aufgezeichnet wird; leer für keine Aufzeichnung
+	std::string recordPath;
+	/// Anzahl Einträge, die die Aufzeichnung fasst, bevor die ältesten überschrieben werden
+	uint64_t recordCapacity = RecordLog::defaultCapacity;
+	/// Nutze statt eines per libusb geöffneten Geräts das simulierte (SimDevice)
+	bool sim = false;
+	/// Parameter des simulierten Geräts
+	SimConfig simConfig;
+	/// Öffne alle angeschlossenen Geräte und führe den Lauf auf allen gleichzeitig aus
+	bool all = false;
+	/// Warte per Hotplug auf Geräte und führe mit jedem den Lauf aus, statt einmalig das erste gefundene zu öffnen
+	bool hotplug = false;
+	/// Anzahl Geräte, nach denen der Hotplug-Modus endet; 0 für unbegrenzt
+	unsigned int boards = 0;
+	/// Anzahl Worker-Threads im Modus --all; 0 für einen je nutzbarem Kern, in jedem Fall höchstens einen je Gerät
+	unsigned int workers = 0;
+	/// Binde die Worker im Modus --all an Kerne des NUMA-Knotens, an dem der Host-Controller ihrer Geräte hängt
+	bool numa = false;
+	/// Auswahl der Geräte nach VID/PID, Pfad und Seriennummer
+	DeviceSelector selector;
+	/// Verteile im Modus --all die Arbeit als einzelne Aufgaben, die freie Worker einander stehlen, statt jedem Worker feste Geräte zuzuteilen
+	bool steal = false;
+	/// Alle Argumente, die keine Optionen sind, inklusive des Programmnamens an erster Stelle
+	std::vector<std::string> positional;
+};
+
+/**
+ * Wandelt eine Größenangabe wie "512", "16k" oder "1M" in eine Anzahl Bytes um, wobei "k" für 1024
+ * und "M" für 1024*1024 Bytes steht. Die Größe muss zwischen 1 Byte und maxTransferSize liegen.
+ */
+size_t parseSize (const std::string& name, const std::string& value) {
+	std::string number = value;
+	double factor = 1;
+	if (!number.empty () && (number.back () == 'k' || number.back () == 'K')) {
+		factor = 1024;
+		number.pop_back ();
+	} else if (!number.empty () && number.back () == 'M') {
+		factor = 1024 * 1024;
+		number.pop_back ();
 	}
+	double res = parseNumber (name, number) * factor;
+	if (res < 1 || res > static_cast<double> (maxTransferSize) || res != static_cast<double> (static_cast<size_t> (res)))
+		throw std::runtime_error ("Ungültiger Wert für " + name + ": " + value);
+	return static_cast<size_t> (res);
+}
+
+/**
+ * Zerlegt die Programmargumente in Optionen der Form "--name [Wert]" und übrige (positionelle) Argumente.
+ * Bei unbekannten Optionen oder fehlenden Werten wird eine Exception ausgelöst.
+ */
+Options parseOptions (const std::vector<std::string>& args) {
+	Options opts;
+	// Ohne --seed wird die aktuelle Uhrzeit als Seed genommen
+	opts.streamConfig.seed = static_cast<uint64_t> (std::chrono::system_clock::now ().time_since_epoch ().count ());
+	if (!args.empty ())
+		opts.positional.push_back (args [0]);
+
+	for (size_t i = 1; i < args.size (); ++i) {
+		const std::string& arg = args [i];
+		if (arg.compare (0, 2, "--") != 0) {
+			opts.positional.push_back (arg);
+			continue;
+		}
+		// Liefert den auf die Option folgenden Wert
+		auto value = [&] () -> const std::string& {
+			if (i + 1 >= args.size ())
+				throw std::runtime_error ("Fehlender Wert für " + arg);
+			return args [++i];
+		};
+
+		if (arg == "--stream")
+			opts.stream = true;
+		else if (arg == "--depth")
+			opts.streamConfig.queueDepth = static_cast<unsigned int> (parseNumber (arg, value ()));
+		else if (arg == "--duration")
+			opts.streamConfig.duration = parseNumber (arg, value ());
+		else if (arg == "--size")
+			opts.streamConfig.transferSize = parseSize (arg, value ());
+		else if (arg == "--quiet")
+			opts.quiet = true;
+		else if (arg == "--repeat") {
+			double repeat = parseNumber (arg, value ());
+			if (repeat != static_cast<double> (static_cast<unsigned int> (repeat)))
+				throw std::runtime_error ("Ungültiger Wert für --repeat");
+			opts.repeat = static_cast<unsigned int> (repeat);
+		} else if (arg == "--histogram")
+			opts.histogram = true;
+		else if (arg == "--zlp")
+			opts.streamConfig.zlp = true;
+		else if (arg == "--pattern")
+			opts.streamConfig.pattern = parsePattern (value ());
+		else if (arg == "--seed")
+			opts.streamConfig.seed = parseSeed (arg, value ());
+		else if (arg == "--kernel") {
+			try {
+				selectReverseKernels (value ());
+			} catch (const std::runtime_error& e) {
+				std::string names;
+				for (const std::string& name : availableReverseKernels ())
+					names += (names.empty () ? "" : ", ") + name;
+				throw std::runtime_error (std::string (e.what ()) + " (verfügbar: " + names + ")");
+			}
+		}
+		else if (arg == "--record")
+			opts.recordPath = value ();
+		else if (arg == "--record-capacity") {
+			double capacity = parseNumber (arg, value ());
+			if (capacity != static_cast<double> (static_cast<uint64_t> (capacity)))
+				throw std::runtime_error ("Ungültiger Wert für --record-capacity");
+			opts.recordCapacity = static_cast<uint64_t> (capacity);
+		} else if (arg == "--verify") {
+			const std::string& mode = value ();
+			if (mode == "compare")
+				opts.streamConfig.verify = VerifyMode::Compare;
+			else if (mode == "crc32c")
+				opts.streamConfig.verify = VerifyMode::Digest;
+			else
+				throw std::runtime_error ("Ungültiger Wert für --verify: " + mode);
+		} else if (arg == "--sim")
+			opts.sim = true;
+		else if (arg == "--sim-latency")
+			opts.simConfig.latency = std::chrono::nanoseconds (static_cast<int64_t> (parseNumber (arg, value ()) * 1e3));
+		else if (arg == "--sim-bandwidth")
+			opts.simConfig.bandwidth = parseNumber (arg, value ()) * 1e6;
+		else if (arg == "--sim-packet-size") {
+			double size = parseNumber (arg, value ());
+			if (size > 1024 || size != static_cast<double> (static_cast<uint16_t> (size)))
+				throw std::runtime_error ("Ungültiger Wert für --sim-packet-size");
+			opts.simConfig.maxPacketSize = static_cast<uint16_t> (size);
+		} else if (arg == "--sim-buffer")
+			opts.simConfig.bufferSize = parseSize (arg, value ());
+		else if (arg == "--all")
+			opts.all = true;
+		else if (arg == "--hotplug")
+			opts.hotplug = true;
+		else if (arg == "--boards") {
+			double boards = parseNumber (arg, value ());
+			if (boards != static_cast<double> (static_cast<unsigned int> (boards)))
+				throw std::runtime_error ("Ungültiger Wert für --boards");
+			opts.boards = static_cast<unsigned int> (boards);
+		} else if (arg == "--workers") {
+			double workers = parseNumber (arg, value ());
+			if (workers != static_cast<double> (static_cast<unsigned int> (workers)))
+				throw std::runtime_error ("Ungültiger Wert für --workers");
+			opts.workers = static_cast<unsigned int> (workers);
+		} else if (arg == "--numa")
+			opts.numa = true;
+		else if (arg == "--steal")
+			opts.steal = true;
+		else if (!parseSelectorOption (args, i, opts.selector))
+			throw std::runtime_error ("Unbekannte Option: " + arg);
+	}
+	if (opts.streamConfig.queueDepth == 0)
+		throw std::runtime_error ("Ungültiger Wert für --depth");
+	return opts;
+}
+
+/**
+ * Gibt das Ergebnis eines Laufs im Streaming-Modus auf der Konsole aus.
+ */
+void printStreamResult (const StreamResult& result, const StreamConfig& config) {
+	std::cout	<< std::dec << "Übertragene Blöcke: " << result.blocks << " (" << result.bytes << " Bytes in " << result.seconds << " s)\n"
+				<< "Durchsatz: " << (result.seconds > 0 ? static_cast<double> (result.bytes) / result.seconds / 1e6 : 0.0) << " MB/s je Richtung\n"
+				<< "Fehlerhafte Blöcke: " << result.mismatches << "\n";
+	if (result.errors.badBlocks > 0)
+		printErrorStats (std::cout, result.errors);
+	std::cout	<< "Transferpuffer: " << (result.deviceMemory ? "vom Kernel gemappt (libusb_dev_mem_alloc)" : "Heap") << "\n"
+				<< "Prüf-Kernel: " << reverseKernels ().name;
+	if (config.verify == VerifyMode::Digest)
+		std::cout << ", CRC-32C: " << crc32cImplementation ();
 	std::cout << std::endl;
-	// Prüfe ob alle Bytes korrekt gedreht wurden
-	std::cout << "Daten stimmen überein: " << std::boolalpha << ok << std::endl;
+}
+
+/**
+ * Gibt die Zusammenfassungen der Latenz-Histogramme aus, in denen Werte erfasst wurden; ist "buckets" gesetzt,
+ * zusätzlich alle belegten Klassen.
+ */
+void printLatencies (const LatencyHistogram& control, const LatencyHistogram& bulk, bool buckets) {
+	if (control.count () > 0)
+		control.printSummary (std::cout, "Control-Transfers");
+	if (bulk.count () > 0)
+		bulk.printSummary (std::cout, "Bulk-Umlauf");
+	if (buckets) {
+		if (control.count () > 0)
+			control.printBuckets (std::cout, "Control-Transfers");
+		if (bulk.count () > 0)
+			bulk.printBuckets (std::cout, "Bulk-Umlauf");
+	}
+	std::cout.flush ();
+}
+
+/**
+ * Führt mit dem geöffneten Gerät die per Kommandozeile gewählte Übertragung aus, d.h. LED-Abfrage und einzelne Blöcke
+ * bzw. den Streaming-Modus, und gibt die Ergebnisse aus. Liefert den Exit-Code: 1, falls Daten fehlerhaft waren, sonst 0.
+ */
+int runDevice (Device& device, const Options& opts, std::ostream& out, RecordLog& record) {
+	const EndpointTable& endpoints = device.endpoints ();
+	out			<< "Bulk-Endpoints: " << std::hex << std::setw (2) << std::setfill ('0') << int { endpoints.bulkOut.address } << "/"
+				<< std::hex << std::setw (2) << std::setfill ('0') << int { endpoints.bulkIn.address }
+				<< std::dec << ", " << endpoints.bulkIn.burstSize () << " Bytes pro Burst" << std::endl;
+
+	// Ohne explizite Angabe wird pro Transfer ein Burst, d.h. bei Full-/High-Speed ein Paket, übertragen
+	StreamConfig config = opts.streamConfig;
+	if (config.transferSize == 0)
+		config.transferSize = endpoints.bulkOut.burstSize ();
+
+	// Strings aus Device-Descriptor abfragen & ausgeben
+	queryStrings (device, out);
+	// Gebe den Seed aus, damit sich der Lauf mit --seed wiederholen lässt
+	std::cout << std::dec << "Muster: " << patternName (config.pattern) << ", Seed: " << config.seed << std::endl;
+
+	// Latenzen der einzelnen Control-Transfers und der Bulk-Umläufe in dataHandling
+	LatencyHistogram controlLatency, bulkLatency;
+	// Die Fehler aller Wiederholungen in dataHandling
+	ErrorStats errors;
+	int res = 0;
+	if (opts.stream) {
+		// LED's abfragen & setzen
+		ledHandling (device, opts.positional, out, controlLatency, record);
+		// Daten fortlaufend auf Bulk Endpoint 1 senden/empfangen
+		StreamCounters counters;
+		StreamResult result;
+		{
+			// Gebe im Quiet-Modus während des Laufs jede Sekunde die aktuellen Raten aus
+			std::unique_ptr<StatsReporter> reporter;
+			if (opts.quiet)
+				reporter.reset (new StatsReporter (counters, std::cout));
+			result = streamHandling (device, config, counters);
+		}
+		printStreamResult (result, config);
+		res = result.mismatches == 0 ? 0 : 1;
+	} else {
+		DataBuffers buffers (device, config.transferSize, config.zlp, out.rdbuf () != nullptr);
+		for (unsigned int i = 0; i < opts.repeat; ++i) {
+			// LED's abfragen & setzen
+			ledHandling (device, opts.positional, out, controlLatency, record);
+			// Daten auf Bulk Endpoint 1 senden/empfangen
+			if (!dataHandling (device, config.transferSize, config.zlp, config.pattern, config.seed, buffers,
+								out, std::cout, bulkLatency, errors, record))
+				res = 1;
+		}
+		// Fasse die Fehler mehrerer Wiederholungen zusammen
+		if (opts.repeat > 1 && errors.badBlocks > 0) {
+			std::cout << "Fehlerhafte Blöcke: " << errors.badBlocks << " von " << errors.blocks << "\n";
+			printErrorStats (std::cout, errors);
+		}
+	}
+	printLatencies (controlLatency, bulkLatency, opts.histogram);
+	return res;
+}
+
+/**
+ * Wartet per Hotplug auf f1usb-Geräte und führt mit jedem sofort nach dem Anschließen runDevice aus. Wird das Gerät
+ * währenddessen entfernt, schlagen die Transfers fehl, der Lauf wird abgebrochen und das Gerät geschlossen; danach wird
+ * auf das nächste gewartet. Endet nach opts.boards Geräten, bei 0 nie. Liefert 1, falls ein Lauf fehlgeschlagen ist.
+ */
+int hotplugHandling (libusb_context* ctx, const Options& opts, std::ostream& out, RecordLog& record) {
+	HotplugMonitor monitor (ctx, opts.selector.vendorId, opts.selector.productId);
+	std::cout << "Warte auf Geräte..." << std::endl;
+	int res = 0;
+	for (unsigned int boards = 0; opts.boards == 0 || boards < opts.boards; ) {
+		HotplugEvent event;
+		if (!monitor.next (event, std::chrono::seconds (1)))
+			continue;
+		libusb_device* dev = event.device.get ();
+		std::cout	<< std::dec << (event.arrived ? "Gerät angeschlossen: " : "Gerät entfernt: ") << int { libusb_get_bus_number (dev) } << ":"
+					<< int { libusb_get_port_number (dev) } << ":" << int { libusb_get_device_address (dev) } << std::endl;
+		// VID und PID prüft bereits libusb, Pfad und Seriennummer nicht
+		if (!event.arrived || !deviceMatches (dev, opts.selector))
+			continue;
+		++boards;
+		// Ein fehlgeschlagener Lauf, z.B. weil das Gerät entfernt wurde, beendet das Warten nicht
+		try {
+			std::unique_ptr<Device> device = openLibusbDevice (ctx, dev);
+			if (runDevice (*device, opts, out, record) != 0)
+				res = 1;
+		} catch (const std::exception& e) {
+			std::cerr << e.what () << std::endl;
+			res = 1;
+		}
+	}
+	return res;
+}
+
+/// Ergebnis des Laufs auf einem Gerät im Modus --all
+struct FanOutResult {
+	/// Bus, Port und Adresse des Geräts
+	std::string name;
+	/// Anzahl übertragener Blöcke und Bytes, Anzahl fehlerhafter Blöcke
+	uint64_t blocks = 0, bytes = 0, mismatches = 0;
+	/// Dauer des Laufs in Sekunden
+	double seconds = 0;
+	/// Fehlermeldung, falls der Lauf abgebrochen wurde
+	std::string error;
+};
+
+/// Bus, Port und Adresse eines per libusb geöffneten Geräts
+std::string deviceName (Device& device) {
+	libusb_device* dev = libusb_get_device (device.handle ());
+	return std::to_string (libusb_get_bus_number (dev)) + ":" + std::to_string (libusb_get_port_number (dev)) + ":"
+			+ std::to_string (libusb_get_device_address (dev));
+}
+
+/// Die Geräte, die ein Worker-Thread im Modus --all bearbeitet, und der Kern, an den er gebunden wird
+struct Shard {
+	/// Positionen der Geräte in der Liste aller Geräte
+	std::vector<size_t> devices;
+	/// Der Kern des Workers
+	unsigned int cpu = 0;
+	/// NUMA-Knoten des Host-Controllers des ersten Geräts, -1 falls unbekannt oder nicht gewünscht
+	int node = -1;
+	/// Gibt an, ob der Worker an "cpu" gebunden werden konnte
+	bool pinned = false;
+};
+
+/**
+ * Teilt die Geräte auf opts.workers Worker auf (bei 0 einer je nutzbarem Kern), höchstens aber einen je Gerät. Jeder
+ * Worker bekommt einen eigenen Kern, solange genug vorhanden sind. Bei opts.numa werden die Geräte zuvor nach dem
+ * NUMA-Knoten ihres Host-Controllers sortiert, sodass die Geräte eines Workers möglichst am selben Knoten hängen, und
+ * der Worker bekommt einen Kern dieses Knotens.
+ */
+std::vector<Shard> planShards (const std::vector<std::unique_ptr<Device>>& devices, const Options& opts) {
+	const std::vector<unsigned int> cpus = usableCpus ();
+	const size_t count = std::min<size_t> (opts.workers == 0 ? cpus.size () : opts.workers, devices.size ());
+
+	std::vector<int> nodes (devices.size (), -1);
+	std::vector<size_t> order (devices.size ());
+	for (size_t i = 0; i < devices.size (); ++i) {
+		order [i] = i;
+		if (opts.numa)
+			nodes [i] = usbBusNumaNode (libusb_get_bus_number (libusb_get_device (devices [i]->handle ())));
+	}
+	std::stable_sort (order.begin (), order.end (), [&] (size_t a, size_t b) { return nodes [a] < nodes [b]; });
+
+	// Zusammenhängende Abschnitte der sortierten Liste, damit Geräte am selben Knoten beim selben Worker landen
+	std::vector<Shard> shards (count);
+	std::vector<std::pair<int, size_t>> nextCpu;
+	for (size_t w = 0; w < count; ++w) {
+		Shard& shard = shards [w];
+		for (size_t i = w * order.size () / count; i < (w + 1) * order.size () / count; ++i)
+			shard.devices.push_back (order [i]);
+		shard.node = nodes [shard.devices.front ()];
+
+		// Die nutzbaren Kerne des Knotens; ohne Knoten oder falls keiner davon nutzbar ist, alle nutzbaren Kerne
+		std::vector<unsigned int> candidates;
+		for (unsigned int cpu : numaNodeCpus (shard.node))
+			if (std::binary_search (cpus.begin (), cpus.end (), cpu))
+				candidates.push_back (cpu);
+		if (candidates.empty ())
+			candidates = cpus;
+		// Verteile die Worker eines Knotens reihum auf dessen Kerne
+		auto next = std::find_if (nextCpu.begin (), nextCpu.end (), [&] (const std::pair<int, size_t>& entry) { return entry.first == shard.node; });
+		if (next == nextCpu.end ())
+			next = nextCpu.insert (nextCpu.end (), std::make_pair (shard.node, size_t { 0 }));
+		shard.cpu = candidates [next->second++ % candidates.size ()];
+	}
+	return shards;
+}
+
+/// Die Parameter für den Lauf auf "device"; bei transferSize 0 wird die Burst-Größe des Geräts eingesetzt
+StreamConfig deviceConfig (Device& device, const Options& opts) {
+	StreamConfig config = opts.streamConfig;
+	if (config.transferSize == 0)
+		config.transferSize = device.endpoints ().bulkOut.burstSize ();
+	return config;
+}
+
+/**
+ * Führt per "run" (streamShard oder streamPooled) den Streaming-Modus auf den Geräten an den Positionen "positions"
+ * aus, deren Lauf nicht bereits abgebrochen wurde, und legt die Ergebnisse in "results" ab. "workers" gibt zu jedem
+ * Gerät den Worker an, dem seine Aufgaben zuerst zugeteilt werden.
+ */
+template <typename Run>
+void fanOutStreams (const std::vector<size_t>& positions, const std::vector<unsigned int>& workers, const std::vector<std::unique_ptr<Device>>& devices,
+		const Options& opts, std::vector<FanOutResult>& results, Run run) {
+	std::vector<ShardStream> streams;
+	std::vector<size_t> running;
+	std::unique_ptr<StreamCounters []> counters (new StreamCounters [positions.size ()]);
+	for (size_t i = 0; i < positions.size (); ++i) {
+		if (!results [positions [i]].error.empty ())
+			continue;
+		ShardStream entry;
+		entry.device = devices [positions [i]].get ();
+		entry.config = deviceConfig (*entry.device, opts);
+		entry.counters = &counters [i];
+		entry.worker = workers [i];
+		streams.push_back (entry);
+		running.push_back (positions [i]);
+	}
+	run (streams);
+	for (size_t i = 0; i < streams.size (); ++i) {
+		FanOutResult& result = results [running [i]];
+		result.error = streams [i].error;
+		result.blocks = streams [i].counters->transfers.get ();
+		result.bytes = streams [i].counters->bytes.get ();
+		result.mismatches = streams [i].counters->mismatches.get ();
+		result.seconds = streams [i].error.empty () ? streams [i].result.seconds : 0;
+	}
+}
+
+/**
+ * Führt auf allen Geräten von "shard" LED-Abfrage und Datenübertragung bzw. den Streaming-Modus aus, ohne etwas
+ * auszugeben, und legt die Ergebnisse an den entsprechenden Positionen in "results" ab. Der aufrufende Thread übernimmt
+ * Erzeugung und Prüfung für alle diese Geräte: Ohne Streaming-Modus werden sie reihum bedient, im Streaming-Modus
+ * laufen sie per streamShard gleichzeitig. Die Latenzen werden in "controlLatency" und "bulkLatency" erfasst, die
+ * sich alle Worker teilen. Bricht der Lauf auf einem Gerät ab, laufen die übrigen weiter.
+ */
+void fanOutShard (const Shard& shard, const std::vector<std::unique_ptr<Device>>& devices, const Options& opts,
+		LatencyHistogram& controlLatency, LatencyHistogram& bulkLatency, std::vector<FanOutResult>& results) {
+	std::ostream discard (nullptr);
+	RecordLog noRecord;
+
+	for (size_t i : shard.devices) {
+		results [i].name = deviceName (*devices [i]);
+		try {
+			ledHandling (*devices [i], opts.positional, discard, controlLatency, noRecord);
+		} catch (const std::exception& e) {
+			results [i].error = e.what ();
+		}
+	}
 
-	return true;
+	if (opts.stream) {
+		fanOutStreams (shard.devices, std::vector<unsigned int> (shard.devices.size (), 0), devices, opts, results, streamShard);
+		return;
+	}
+	std::vector<ErrorStats> errors (shard.devices.size ());
+	// Die Parameter und Puffer jedes Geräts werden vor den Wiederholungen angelegt
+	std::vector<StreamConfig> configs;
+	std::vector<std::unique_ptr<DataBuffers>> buffers (shard.devices.size ());
+	for (size_t i = 0; i < shard.devices.size (); ++i) {
+		Device& device = *devices [shard.devices [i]];
+		configs.push_back (deviceConfig (device, opts));
+		try {
+			buffers [i].reset (new DataBuffers (device, configs [i].transferSize, configs [i].zlp, false));
+		} catch (const std::exception& e) {
+			results [shard.devices [i]].error = e.what ();
+		}
+	}
+	const auto start = std::chrono::steady_clock::now ();
+	for (unsigned int r = 0; r < opts.repeat; ++r) {
+		for (size_t i = 0; i < shard.devices.size (); ++i) {
+			Device& device = *devices [shard.devices [i]];
+			FanOutResult& result = results [shard.devices [i]];
+			if (!result.error.empty ())
+				continue;
+			try {
+				const StreamConfig& config = configs [i];
+				ledHandling (device, opts.positional, discard, controlLatency, noRecord);
+				dataHandling (device, config.transferSize, config.zlp, config.pattern, config.seed, *buffers [i], discard, discard, bulkLatency, errors [i], noRecord);
+			} catch (const std::exception& e) {
+				result.error = e.what ();
+			}
+		}
+	}
+	// Die Geräte wurden abwechselnd bedient, ihre Laufzeit ist also die des ganzen Shards
+	const double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+	for (size_t i = 0; i < shard.devices.size (); ++i) {
+		FanOutResult& result = results [shard.devices [i]];
+		result.seconds = seconds;
+		result.blocks = errors [i].blocks;
+		result.bytes = errors [i].bytes;
+		result.mismatches = errors [i].badBlocks;
+	}
+}
+
+/**
+ * Eine Aufgabe im Modus --all --steal, die auf einem Gerät LED-Abfrage und Datenübertragung wie fanOutShard ausführt.
+ * Jede Ausführung übernimmt einen Durchgang und reiht dann den nächsten beim ausführenden Worker ein, sodass ein
+ * freier Worker das Gerät übernehmen kann, während dieser mit einem langsamen Gerät beschäftigt ist. Die erste
+ * Ausführung fragt nur die LEDs ab; im Streaming-Modus bleibt es dabei.
+ */
+class DataTask : public Task {
+	public:
+		DataTask (Device& device, const Options& opts, TaskPool& pool, LatencyHistogram& controlLatency, LatencyHistogram& bulkLatency, FanOutResult& result)
+			: m_device (device), m_opts (opts), m_config (deviceConfig (device, opts)), m_pool (pool), m_controlLatency (controlLatency),
+			  m_bulkLatency (bulkLatency), m_result (result), m_remaining (opts.stream ? 1 : opts.repeat + 1), m_first (true),
+			  m_buffers (opts.stream ? nullptr : new DataBuffers (device, m_config.transferSize, m_config.zlp, false)), m_start (std::chrono::steady_clock::now ()) {}
+
+		void run (unsigned int worker) override {
+			std::ostream discard (nullptr);
+			RecordLog noRecord;
+			try {
+				ledHandling (m_device, m_opts.positional, discard, m_controlLatency, noRecord);
+				if (!m_first)
+					dataHandling (m_device, m_config.transferSize, m_config.zlp, m_config.pattern, m_config.seed, *m_buffers, discard, discard, m_bulkLatency, m_errors, noRecord);
+			} catch (const std::exception& e) {
+				m_result.error = e.what ();
+			}
+			m_first = false;
+			if (--m_remaining > 0 && m_result.error.empty ()) {
+				m_pool.submit (this, worker);
+				return;
+			}
+			if (!m_opts.stream) {
+				m_result.seconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - m_start).count ();
+				m_result.blocks = m_errors.blocks;
+				m_result.bytes = m_errors.bytes;
+				m_result.mismatches = m_errors.badBlocks;
+			}
+			m_pool.release ();
+		}
+	private:
+		Device& m_device;
+		const Options& m_opts;
+		const StreamConfig m_config;
+		TaskPool& m_pool;
+		LatencyHistogram& m_controlLatency;
+		LatencyHistogram& m_bulkLatency;
+		FanOutResult& m_result;
+		/// Anzahl verbleibender Durchgänge inklusive des laufenden
+		unsigned int m_remaining;
+		bool m_first;
+		/// Die Puffer für alle Durchgänge; im Streaming-Modus nicht benötigt
+		std::unique_ptr<DataBuffers> m_buffers;
+		ErrorStats m_errors;
+		std::chrono::steady_clock::time_point m_start;
+};
+
+/**
+ * Führt wie fanOutShard den Lauf auf allen Geräten aus, aber in einem TaskPool mit einem Worker je Shard. Die Aufgaben
+ * eines Geräts landen zunächst beim Worker seines Shards, werden aber von freien Workern gestohlen, sodass langsame
+ * Geräte nicht die übrigen ihres Shards aufhalten. Ohne Streaming-Modus ist jeder Durchgang von LED-Abfrage und
+ * Datenübertragung eine Aufgabe (DataTask), im Streaming-Modus die Auswertung der abgeschlossenen Transfers eines
+ * Geräts (siehe streamPooled). Liefert die Anzahl gestohlener Aufgaben.
+ */
+uint64_t fanOutPooled (std::vector<Shard>& shards, const std::vector<std::unique_ptr<Device>>& devices, const Options& opts,
+		LatencyHistogram& controlLatency, LatencyHistogram& bulkLatency, std::vector<FanOutResult>& results) {
+	std::vector<unsigned int> cpus;
+	std::vector<size_t> positions;
+	std::vector<unsigned int> homes;
+	for (size_t w = 0; w < shards.size (); ++w) {
+		cpus.push_back (shards [w].cpu);
+		for (size_t i : shards [w].devices) {
+			positions.push_back (i);
+			homes.push_back (static_cast<unsigned int> (w));
+		}
+	}
+	TaskPool pool (cpus);
+
+	std::vector<std::unique_ptr<DataTask>> tasks;
+	for (size_t i = 0; i < positions.size (); ++i) {
+		results [positions [i]].name = deviceName (*devices [positions [i]]);
+		try {
+			tasks.emplace_back (new DataTask (*devices [positions [i]], opts, pool, controlLatency, bulkLatency, results [positions [i]]));
+		} catch (const std::exception& e) {
+			results [positions [i]].error = e.what ();
+			continue;
+		}
+		pool.hold ();
+		pool.submit (tasks.back ().get (), homes [i]);
+	}
+	pool.wait ();
+	if (opts.stream)
+		fanOutStreams (positions, homes, devices, opts, results, [&] (std::vector<ShardStream>& streams) { streamPooled (streams, pool); });
+
+	for (size_t w = 0; w < shards.size (); ++w)
+		shards [w].pinned = pool.pinned (static_cast<unsigned int> (w));
+	return pool.steals ();
+}
+
+/**
+ * Öffnet alle angeschlossenen f1usb-Geräte, teilt sie per planShards auf eine Anzahl Worker-Threads auf und führt
+ * in jedem Worker per fanOutShard gleichzeitig den Lauf auf seinen Geräten aus. Jeder Worker wird an seinen Kern
+ * gebunden, sodass die Daten seiner Geräte in dessen Cache bleiben. Alle Geräte teilen sich den libusb-Kontext und
+ * einen Event-Thread, der nur die Callbacks ausführt. Am Ende werden Durchsatz und Fehler je Gerät und insgesamt
+ * ausgegeben. Liefert 1, falls auf einem Gerät Daten fehlerhaft waren oder der Lauf abgebrochen wurde, sonst 0.
+ */
+int fanOutHandling (libusb_context* ctx, const Options& opts, std::ostream& out) {
+	// Der gemeinsame Event-Thread; muss länger bestehen als die Geräte
+	UsbEventLoop events (ctx);
+	std::vector<std::unique_ptr<Device>> devices = openAllLibusbDevices (ctx, events, out, opts.selector);
+	std::vector<Shard> shards = planShards (devices, opts);
+	std::cout << std::dec << "Geräte: " << devices.size () << ", Worker: " << shards.size () << ", Muster: " << patternName (opts.streamConfig.pattern)
+		<< ", Seed: " << opts.streamConfig.seed << std::endl;
+
+	LatencyHistogram controlLatency, bulkLatency;
+	std::vector<FanOutResult> results (devices.size ());
+	std::vector<std::thread> workers;
+	workers.reserve (shards.size ());
+	const auto start = std::chrono::steady_clock::now ();
+	uint64_t steals = 0;
+	if (opts.steal)
+		steals = fanOutPooled (shards, devices, opts, controlLatency, bulkLatency, results);
+	else {
+		for (Shard& shard : shards)
+			workers.emplace_back ([&] () {
+				shard.pinned = pinCurrentThread (shard.cpu);
+				// Eine Exception darf den Thread nicht verlassen; sie betrifft z.B. bei einem Fehler des gemeinsamen
+				// Event-Threads alle Geräte des Shards, die bis dahin noch fehlerfrei liefen
+				std::string error;
+				try {
+					fanOutShard (shard, devices, opts, controlLatency, bulkLatency, results);
+				} catch (const std::exception& e) {
+					error = e.what ();
+				} catch (...) {
+					error = "Unbekannter Fehler";
+				}
+				if (!error.empty ())
+					for (size_t i : shard.devices)
+						if (results [i].error.empty ())
+							results [i].error = error;
+			});
+		for (std::thread& worker : workers)
+			worker.join ();
+	}
+	const double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+	for (size_t w = 0; w < shards.size (); ++w) {
+		out << "Worker " << w << ": " << (shards [w].pinned ? "Kern " + std::to_string (shards [w].cpu) : std::string ("nicht gebunden"));
+		if (shards [w].node >= 0)
+			out << " (NUMA-Knoten " << shards [w].node << ")";
+		out << ", Geräte:";
+		for (size_t i : shards [w].devices)
+			out << " " << results [i].name;
+		out << "\n";
+	}
+
+	int res = 0;
+	FanOutResult total;
+	for (const FanOutResult& result : results) {
+		char line [200];
+		std::snprintf (line, sizeof (line), "%-12s %10llu Blöcke %9.3f MB/s, fehlerhafte Blöcke: %llu", result.name.c_str (),
+				static_cast<unsigned long long> (result.blocks), result.seconds > 0 ? static_cast<double> (result.bytes) / result.seconds / 1e6 : 0.0,
+				static_cast<unsigned long long> (result.mismatches));
+		std::cout << line;
+		if (!result.error.empty ())
+			std::cout << ", abgebrochen: " << result.error;
+		std::cout << "\n";
+		total.blocks += result.blocks;
+		total.bytes += result.bytes;
+		total.mismatches += result.mismatches;
+		if (result.mismatches > 0 || !result.error.empty ())
+			res = 1;
+	}
+	char line [200];
+	std::snprintf (line, sizeof (line), "Gesamt: %llu Blöcke (%llu Bytes in %.3f s), %.3f MB/s je Richtung, fehlerhafte Blöcke: %llu\n",
+			static_cast<unsigned long long> (total.blocks), static_cast<unsigned long long> (total.bytes), seconds,
+			seconds > 0 ? static_cast<double> (total.bytes) / seconds / 1e6 : 0.0, static_cast<unsigned long long> (total.mismatches));
+	std::cout << line;
+	if (opts.steal)
+		std::cout << "Gestohlene Aufgaben: " << steals << "\n";
+	printLatencies (controlLatency, bulkLatency, opts.histogram);
+	return res;
 }
 
 int main (int argc, char* argv []) {
 	try {
 		// Konvertiere Programmargumente in C++-Datenstruktur
 		std::vector<std::string> args (argv, argv+argc);
+		Options opts = parseOptions (args);
+		// Zeichne die einzelnen Transfers auf, falls gewünscht
+		std::unique_ptr<RecordLog> record (opts.recordPath.empty () ? new RecordLog () : new RecordLog (opts.recordPath, opts.recordCapacity));
 		
-		// Initialisiere libusb
-		libusb_context* ctx;
-		lu_err (libusb_init (&ctx), "Initialisierung von libusb fehlgeschlagen: ");
-		// Verpacke libusb Kontext in unique_ptr für automatische Freigabe
-		CtxPtr ctxPtr (ctx);
-
-		// Öffne Gerät
-		libusb_device_descriptor foundDeviceDescriptor {};
-		DevPtr handle = openDevice (foundDeviceDescriptor);
-
-		// Strings aus Device-Descriptor abfragen & ausgeben
-		queryStrings (handle.get (), foundDeviceDescriptor);
-		// LED's abfragen & setzen
-		ledHandling (handle.get (), args);
-		// Daten auf Bulk Endpoint 1 senden/empfangen
-		return (dataHandling (handle.get ()) ? 0 : 1);
+		// Im Quiet-Modus landen die ausführlichen Ausgaben in einem Stream ohne Puffer, der sie verwirft, ohne sie zu formatieren
+		std::ostream discard (nullptr);
+		std::ostream& out = opts.quiet ? discard : std::cout;
+
+		// Der libusb Kontext in unique_ptr für automatische Freigabe; muss länger bestehen als das Gerät
+		CtxPtr ctxPtr;
+		std::unique_ptr<Device> device;
+		if (opts.all) {
+			if (opts.sim || opts.hotplug || !opts.recordPath.empty ())
+				throw std::runtime_error ("--all kann nicht mit --sim, --hotplug oder --record kombiniert werden");
+			// Initialisiere libusb
+			libusb_context* ctx;
+			lu_err (libusb_init (&ctx), "Initialisierung von libusb fehlgeschlagen: ");
+			ctxPtr.reset (ctx);
+			return fanOutHandling (ctx, opts, out);
+		} else if (opts.hotplug) {
+			if (opts.sim)
+				throw std::runtime_error ("--hotplug und --sim können nicht kombiniert werden");
+			// Initialisiere libusb
+			libusb_context* ctx;
+			lu_err (libusb_init (&ctx), "Initialisierung von libusb fehlgeschlagen: ");
+			ctxPtr.reset (ctx);
+			return hotplugHandling (ctx, opts, out, *record);
+		} else if (opts.sim) {
+			// Das simulierte Gerät braucht libusb nur für die Transfer-Strukturen
+			device.reset (new SimDevice (opts.simConfig));
+			out << "Simuliertes Gerät: ID " << std::hex << std::setw (4) << std::setfill ('0') << device->descriptor ().idVendor << ":"
+				<< std::setw (4) << std::setfill ('0') << device->descriptor ().idProduct << std::endl;
+		} else {
+			// Initialisiere libusb
+			libusb_context* ctx;
+			lu_err (libusb_init (&ctx), "Initialisierung von libusb fehlgeschlagen: ");
+			ctxPtr.reset (ctx);
+			// Öffne Gerät
+			device = openLibusbDevice (ctx, out, opts.selector);
+		}
+		return runDevice (*device, opts, out, *record);
 	} catch (const std::exception& e) {
 		// Gebe Exception-Text aus
 		std::cerr << e.what () << std::endl;
@@ -266,4 +923,3 @@ int main (int argc, char* argv []) {
 		return 1;
 	}
 }
-
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include "mismatch.hh"
+#include "reverse.hh"
+
+namespace {
+
+/// Anzahl gesetzter Bits
+inline unsigned int popcount (uint64_t val) {
+	// Parallel in Bit-Paaren, Nibbles und Bytes zählen, damit kein spezieller Befehlssatz nötig ist
+	val = val - ((val >> 1) & 0x5555555555555555ull);
+	val = (val & 0x3333333333333333ull) + ((val >> 2) & 0x3333333333333333ull);
+	val = (val + (val >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+	return static_cast<unsigned int> ((val * 0x0101010101010101ull) >> 56);
+}
+
+/// Formatiert die Syndrom-Bits als Binärzahl, höchstwertiges Bit zuerst
+void formatSyndrome (char (&buffer) [9], uint8_t syndrome) {
+	for (unsigned int bit = 0; bit < 8; ++bit)
+		buffer [bit] = (syndrome & (0x80 >> bit)) ? '1' : '0';
+	buffer [8] = 0;
+}
+
+}
+
+void BlockErrors::merge (const BlockErrors& part, size_t offset) {
+	if (part.badBytes == 0)
+		return;
+	if (badBytes == 0)
+		firstOffset = offset + part.firstOffset;
+	badBytes += part.badBytes;
+	badBits += part.badBits;
+	syndrome = static_cast<uint8_t> (syndrome | part.syndrome);
+}
+
+BlockErrors analyzeReversed (const unsigned char* tx, const unsigned char* rx, size_t length) {
+	BlockErrors errors;
+	uint64_t syndrome = 0;
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8) {
+		uint64_t txWord, rxWord;
+		std::memcpy (&txWord, tx + i, 8);
+		std::memcpy (&rxWord, rx + i, 8);
+		uint64_t diff = reverseBytewise (txWord) ^ rxWord;
+		if (diff == 0)
+			continue;
+		// Markiere in jedem Byte das unterste Bit, falls das Byte falsch ist, und zähle die Markierungen
+		uint64_t bytes = diff | (diff >> 4);
+		bytes |= bytes >> 2;
+		bytes |= bytes >> 1;
+		bytes &= 0x0101010101010101ull;
+		if (errors.badBytes == 0) {
+			// Suche das erste falsche Byte des Worts byteweise, damit das Ergebnis nicht von der Byte-Reihenfolge abhängt
+			size_t first = 0;
+			while (reverse (tx [i + first]) == rx [i + first])
+				++first;
+			errors.firstOffset = i + first;
+		}
+		errors.badBytes += popcount (bytes);
+		errors.badBits += popcount (diff);
+		syndrome |= diff;
+	}
+	for (; i < length; ++i) {
+		uint8_t diff = static_cast<uint8_t> (reverse (tx [i]) ^ rx [i]);
+		if (diff == 0)
+			continue;
+		if (errors.badBytes == 0)
+			errors.firstOffset = i;
+		++errors.badBytes;
+		errors.badBits += popcount (diff);
+		syndrome |= diff;
+	}
+	// Falte die 8 Bytes des Wort-Syndroms auf ein Byte
+	syndrome |= syndrome >> 32;
+	syndrome |= syndrome >> 16;
+	syndrome |= syndrome >> 8;
+	errors.syndrome = static_cast<uint8_t> (syndrome);
+	return errors;
+}
+
+void addLengthMismatch (BlockErrors& errors, size_t offset, size_t count) {
+	if (count == 0)
+		return;
+	if (errors.badBytes == 0)
+		errors.firstOffset = offset;
+	errors.badBytes += count;
+	errors.badBits += 8 * uint64_t { count };
+	errors.syndrome = 0xFF;
+}
+
+void ErrorStats::add (uint64_t block, size_t length, const BlockErrors& errors) {
+	++blocks;
+	bytes += length;
+	if (errors.ok ())
+		return;
+	if (badBlocks == 0) {
+		firstBadBlock = block;
+		firstBadOffset = errors.firstOffset;
+	}
+	++badBlocks;
+	badBytes += errors.badBytes;
+	badBits += errors.badBits;
+	syndrome = static_cast<uint8_t> (syndrome | errors.syndrome);
+}
+
+double ErrorStats::bitErrorRate () const {
+	return bytes == 0 ? 0.0 : static_cast<double> (badBits) / (8.0 * static_cast<double> (bytes));
+}
+
+void printBlockErrors (std::ostream& os, const BlockErrors& errors, size_t length) {
+	char syndrome [9];
+	formatSyndrome (syndrome, errors.syndrome);
+	char line [160];
+	std::snprintf (line, sizeof (line), "Erstes falsches Byte: %zu, falsche Bytes: %llu von %zu, falsche Bits: %llu (BER %.3g), Syndrom: %s\n",
+			errors.firstOffset, static_cast<unsigned long long> (errors.badBytes), length, static_cast<unsigned long long> (errors.badBits),
+			length == 0 ? 0.0 : static_cast<double> (errors.badBits) / (8.0 * static_cast<double> (length)), syndrome);
+	os << line;
+}
+
+void printErrorStats (std::ostream& os, const ErrorStats& stats) {
+	char syndrome [9];
+	formatSyndrome (syndrome, stats.syndrome);
+	char line [200];
+	std::snprintf (line, sizeof (line), "Erster fehlerhafter Block: %llu (ab Byte %zu), falsche Bytes: %llu, falsche Bits: %llu, BER: %.3g, Syndrom: %s\n",
+			static_cast<unsigned long long> (stats.firstBadBlock), stats.firstBadOffset, static_cast<unsigned long long> (stats.badBytes),
+			static_cast<unsigned long long> (stats.badBits), stats.bitErrorRate (), syndrome);
+	os << line;
+}
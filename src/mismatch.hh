@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MISMATCH_HH_
+#define MISMATCH_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * Die Fehler in der Antwort auf einen einzelnen Block. Da die Prüfung per SIMD-Kernel nur das Gesamtergebnis
+ * liefert, werden diese Angaben nur für fehlerhafte Blöcke (bzw. Abschnitte davon) mit analyzeReversed ermittelt.
+ */
+struct BlockErrors {
+	/// Position des ersten falschen Bytes im Block; nur gültig, wenn badBytes > 0
+	size_t firstOffset = 0;
+	/// Anzahl falscher Bytes; fehlende Bytes einer zu kurzen Antwort zählen als falsch
+	uint64_t badBytes = 0;
+	/// Anzahl falscher Bits; fehlende Bytes zählen mit allen 8 Bits
+	uint64_t badBits = 0;
+	/// Bitweises ODER der Differenzen (erwartet XOR empfangen) aller Bytes, d.h. welche Bit-Positionen betroffen sind
+	uint8_t syndrome = 0;
+
+	bool ok () const { return badBytes == 0; }
+
+	/// Übernimmt die Fehler eines Abschnitts, der an Position "offset" des Blocks beginnt
+	void merge (const BlockErrors& part, size_t offset);
+};
+
+/**
+ * Vergleicht "length" Bytes der Antwort "rx" mit den umgedrehten Bytes aus "tx" und ermittelt die Fehler.
+ * Verarbeitet 8 Bytes auf einmal, ist aber deutlich langsamer als die Kernel und daher für den Fehlerfall gedacht.
+ */
+BlockErrors analyzeReversed (const unsigned char* tx, const unsigned char* rx, size_t length);
+
+/**
+ * Trägt bei einer Antwort mit falscher Länge die "count" fehlenden bzw. überzähligen Bytes ab Position "offset"
+ * als falsch in "errors" ein.
+ */
+void addLengthMismatch (BlockErrors& errors, size_t offset, size_t count);
+
+/**
+ * Die über einen ganzen Lauf zusammengefassten Fehler. Von jedem Block werden nur die Zähler übernommen,
+ * sodass der Speicherbedarf nicht von der Laufzeit abhängt; nur der erste fehlerhafte Block wird genauer festgehalten.
+ */
+struct ErrorStats {
+	/// Anzahl geprüfter Blöcke und Bytes
+	uint64_t blocks = 0, bytes = 0;
+	/// Anzahl fehlerhafter Blöcke, falscher Bytes und falscher Bits
+	uint64_t badBlocks = 0, badBytes = 0, badBits = 0;
+	/// ODER der Syndrome aller Blöcke
+	uint8_t syndrome = 0;
+	/// Nummer des ersten fehlerhaften Blocks und Position des ersten falschen Bytes darin
+	uint64_t firstBadBlock = 0;
+	size_t firstBadOffset = 0;
+
+	/// Übernimmt das Ergebnis der Prüfung von Block Nummer "block" mit "length" Bytes
+	void add (uint64_t block, size_t length, const BlockErrors& errors);
+	/// Bitfehlerrate, d.h. Anteil falscher Bits an allen geprüften Bits
+	double bitErrorRate () const;
+};
+
+/// Gibt die Fehler eines einzelnen Blocks in einer Zeile aus
+void printBlockErrors (std::ostream& os, const BlockErrors& errors, size_t length);
+
+/// Gibt die zusammengefassten Fehler eines Laufs aus
+void printErrorStats (std::ostream& os, const ErrorStats& stats);
+
+#endif /* MISMATCH_HH_ */
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <limits>
+#include <stdexcept>
+#include "options.hh"
+#include "usb.hh"
+
+double parseNumber (const std::string& name, const std::string& value) {
+	size_t pos = 0;
+	double res = 0;
+	try {
+		res = std::stod (value, &pos);
+	} catch (const std::exception&) {
+		pos = 0;
+	}
+	if (pos == 0 || pos != value.size () || !(res > 0))
+		throw std::runtime_error ("Ungültiger Wert für " + name + ": " + value);
+	return res;
+}
+
+unsigned int parseUnsigned (const std::string& name, const std::string& value) {
+	size_t pos = 0;
+	unsigned long res = 0;
+	try {
+		res = std::stoul (value, &pos, 10);
+	} catch (const std::exception&) {
+		pos = 0;
+	}
+	if (pos == 0 || pos != value.size () || value [0] == '-' || res > std::numeric_limits<unsigned int>::max ())
+		throw std::runtime_error ("Ungültiger Wert für " + name + ": " + value);
+	return static_cast<unsigned int> (res);
+}
+
+uint64_t parseSeed (const std::string& name, const std::string& value) {
+	size_t pos = 0;
+	unsigned long long res = 0;
+	try {
+		res = std::stoull (value, &pos, 0);
+	} catch (const std::exception&) {
+		pos = 0;
+	}
+	if (pos == 0 || pos != value.size () || value [0] == '-')
+		throw std::runtime_error ("Ungültiger Wert für " + name + ": " + value);
+	return res;
+}
+
+uint16_t parseId (const std::string& name, const std::string& value) {
+	size_t pos = 0;
+	unsigned long res = 0;
+	try {
+		res = std::stoul (value, &pos, 16);
+	} catch (const std::exception&) {
+		pos = 0;
+	}
+	if (pos == 0 || pos != value.size () || value [0] == '-' || res > 0xFFFF)
+		throw std::runtime_error ("Ungültiger Wert für " + name + ": " + value);
+	return static_cast<uint16_t> (res);
+}
+
+bool parseSelectorOption (const std::vector<std::string>& args, size_t& i, DeviceSelector& selector) {
+	const std::string& arg = args [i];
+	if (arg != "--vid" && arg != "--pid" && arg != "--serial" && arg != "--path")
+		return false;
+	if (i + 1 >= args.size ())
+		throw std::runtime_error ("Fehlender Wert für " + arg);
+	const std::string& value = args [++i];
+	if (arg == "--vid")
+		selector.vendorId = parseId (arg, value);
+	else if (arg == "--pid")
+		selector.productId = parseId (arg, value);
+	else if (arg == "--serial")
+		selector.serial = value;
+	else
+		parseDevicePath (value, selector);
+	return true;
+}
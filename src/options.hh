@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef OPTIONS_HH_
+#define OPTIONS_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct DeviceSelector;
+
+/*
+ * Umwandlung der Werte von Kommandozeilen-Optionen, gemeinsam genutzt von usbclient und usbreplay. Bei ungültigen
+ * Werten wird jeweils eine Exception mit dem Namen der Option "name" ausgelöst.
+ */
+
+/// Wandelt den Wert in eine Zahl um, die größer als 0 sein muss
+double parseNumber (const std::string& name, const std::string& value);
+
+/// Wandelt den Wert in eine ganze Zahl ab 0 um, z.B. für Timeouts, bei denen 0 wie bei libusb "unbegrenzt" bedeutet
+unsigned int parseUnsigned (const std::string& name, const std::string& value);
+
+/// Wandelt den Wert in eine 64-Bit-Zahl um, auch in hexadezimaler Schreibweise mit "0x", z.B. für --seed
+uint64_t parseSeed (const std::string& name, const std::string& value);
+
+/**
+ * Wandelt den Wert in eine 16-Bit-ID um, z.B. für --vid und --pid. Wie bei lsusb ist die Angabe hexadezimal,
+ * wahlweise mit "0x" davor.
+ */
+uint16_t parseId (const std::string& name, const std::string& value);
+
+/**
+ * Wertet "args [i]" aus, falls es eine der Optionen --vid, --pid, --serial oder --path zur Auswahl des Geräts ist,
+ * trägt sie in "selector" ein und zählt "i" auf ihren Wert weiter. Gibt false zurück, wenn es keine dieser Optionen ist.
+ */
+bool parseSelectorOption (const std::vector<std::string>& args, size_t& i, DeviceSelector& selector);
+
+#endif /* OPTIONS_HH_ */
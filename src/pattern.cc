@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "pattern.hh"
+#include "kernels.hh"
+#include "mismatch.hh"
+
+namespace {
+
+/// Die Namen der Muster in der Reihenfolge von PatternType
+const char* const names [] = { "random", "prbs7", "prbs15", "prbs31", "counter", "walking-ones", "walking-zeros", "zeros", "ones" };
+static_assert (sizeof (names) / sizeof (names [0]) == patternCount, "Zu jedem Muster gehört ein Name");
+
+/// Größe der Abschnitte, in denen verifyReversed die erwarteten Daten auf dem Stack erzeugt
+constexpr size_t verifyChunk = 4096;
+
+/// Periode der PRBS-31-Folge in Bits
+constexpr uint64_t prbs31Period = (uint64_t { 1 } << 31) - 1;
+
+/**
+ * Schreibt "value" im Little-Endian-Format, d.h. das niederwertigste Byte zuerst, nach "dst", das nicht ausgerichtet
+ * sein muss. So ergeben sich auf jeder CPU dieselben Daten wie beim byteweisen Schreiben der übrigen Fälle.
+ */
+inline void storeLe64 (unsigned char* dst, uint64_t value) {
+#if defined (__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	for (unsigned int b = 0; b < 8; ++b)
+		dst [b] = static_cast<unsigned char> (value >> (8 * b));
+#else
+	// Ohne __BYTE_ORDER__ (MSVC) ist die CPU immer Little-Endian. memcpy statt Cast, da der Puffer nicht ausgerichtet
+	// sein muss; wird vom Compiler zu einem Store
+	std::memcpy (dst, &value, 8);
+#endif
+}
+
+/**
+ * Schaltet ein Fibonacci-LFSR der Länge n mit der Rekursion b[i] = b[i-n] ^ b[i-m] um "count" Bits weiter und liefert
+ * diese Bits, das älteste im niederwertigsten Bit. "window" enthält die letzten n Bits der Folge, das älteste im
+ * niederwertigsten Bit. Da jedes neue Bit nur von Bits abhängt, die mindestens m Schritte zurückliegen, können bis zu
+ * m Bits auf einmal berechnet werden.
+ */
+inline uint32_t lfsrStep (uint32_t& window, unsigned int n, unsigned int m, unsigned int count) {
+	const uint32_t mask = (uint32_t { 1 } << count) - 1;
+	const uint32_t out = window & mask;
+	const uint32_t fresh = (window ^ (window >> (n - m))) & mask;
+	window = (window >> count) | (fresh << (n - count));
+	return out;
+}
+
+/// Erzeugt eine volle Periode (2^n-1 Bytes, d.h. 8 Perioden der Bitfolge) einer PRBS-Folge
+std::vector<unsigned char> makePrbsTable (unsigned int n, unsigned int m) {
+	std::vector<unsigned char> table ((size_t { 1 } << n) - 1);
+	uint32_t window = (uint32_t { 1 } << n) - 1;
+	for (unsigned char& byte : table) {
+		// Da m < 8 sein kann, werden die Bits einzeln erzeugt; dies geschieht nur einmalig
+		unsigned int val = 0;
+		for (unsigned int bit = 0; bit < 8; ++bit)
+			val |= lfsrStep (window, n, m, 1) << bit;
+		byte = static_cast<unsigned char> (val);
+	}
+	return table;
+}
+
+const std::vector<unsigned char>& prbs7Table () {
+	static const std::vector<unsigned char> table = makePrbsTable (7, 6);
+	return table;
+}
+
+const std::vector<unsigned char>& prbs15Table () {
+	static const std::vector<unsigned char> table = makePrbsTable (15, 14);
+	return table;
+}
+
+/**
+ * Erzeugt eine Tabelle mit 256 Bytes für die Muster mit kurzer Periode (Counter, WalkingOnes, WalkingZeros),
+ * damit diese wie die PRBS-Muster abschnittsweise kopiert statt Byte für Byte berechnet werden können.
+ */
+std::vector<unsigned char> makeShortTable (PatternType type) {
+	std::vector<unsigned char> table (256);
+	for (unsigned int i = 0; i < 256; ++i) {
+		if (type == PatternType::Counter)
+			table [i] = static_cast<unsigned char> (i);
+		else if (type == PatternType::WalkingOnes)
+			table [i] = static_cast<unsigned char> (1u << (i & 7));
+		else
+			table [i] = static_cast<unsigned char> (~(1u << (i & 7)));
+	}
+	return table;
+}
+
+const std::vector<unsigned char>& shortTable (PatternType type) {
+	static const std::vector<unsigned char> counter = makeShortTable (PatternType::Counter);
+	static const std::vector<unsigned char> walkingOnes = makeShortTable (PatternType::WalkingOnes);
+	static const std::vector<unsigned char> walkingZeros = makeShortTable (PatternType::WalkingZeros);
+	return type == PatternType::Counter ? counter : type == PatternType::WalkingOnes ? walkingOnes : walkingZeros;
+}
+
+/**
+ * Die Potenzen M^(2^i) der Übergangsmatrix M des PRBS-31-LFSR über GF(2), mit denen der Zustand an einer beliebigen
+ * Position der Folge in höchstens 31 Schritten berechnet werden kann. Jede Matrix ist als Liste ihrer Spalten abgelegt.
+ */
+struct Prbs31Jumps {
+	uint32_t columns [31][31];
+
+	Prbs31Jumps () {
+		// M selbst: Spalte c ist das Bild des Zustands, in dem nur Bit c gesetzt ist
+		for (unsigned int c = 0; c < 31; ++c) {
+			uint32_t window = uint32_t { 1 } << c;
+			lfsrStep (window, 31, 28, 1);
+			columns [0][c] = window;
+		}
+		// Quadriere wiederholt
+		for (unsigned int i = 1; i < 31; ++i)
+			for (unsigned int c = 0; c < 31; ++c)
+				columns [i][c] = apply (columns [i-1], columns [i-1][c]);
+	}
+
+	/// Multipliziert die Matrix mit dem Vektor "v"
+	static uint32_t apply (const uint32_t (&matrix) [31], uint32_t v) {
+		uint32_t res = 0;
+		for (unsigned int c = 0; c < 31; ++c)
+			if (v & (uint32_t { 1 } << c))
+				res ^= matrix [c];
+		return res;
+	}
+};
+
+const Prbs31Jumps& prbs31Jumps () {
+	static const Prbs31Jumps jumps;
+	return jumps;
+}
+
+/// Zufallswert Nummer "index" des Stroms mit dem Seed "seed", berechnet mit splitmix64 ohne Zustand
+inline uint64_t randomWord (uint64_t seed, uint64_t index) {
+	uint64_t z = seed + (index + 1) * 0x9E3779B97F4A7C15ull;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+}
+
+const char* patternName (PatternType type) {
+	return names [static_cast<size_t> (type)];
+}
+
+PatternType parsePattern (const std::string& name) {
+	for (size_t i = 0; i < sizeof (names) / sizeof (names [0]); ++i)
+		if (name == names [i])
+			return static_cast<PatternType> (i);
+	throw std::runtime_error ("Unbekanntes Muster: " + name);
+}
+
+std::vector<std::string> patternNames () {
+	return std::vector<std::string> (std::begin (names), std::end (names));
+}
+
+Pattern::Pattern (PatternType type, uint64_t seed) : m_type (type), m_seed (seed), m_offset (0), m_lfsr (0) {
+	// Berechne die Tabellen bereits hier und nicht erst beim ersten Erzeugen von Daten
+	if (m_type == PatternType::Prbs7)
+		prbs7Table ();
+	else if (m_type == PatternType::Prbs15)
+		prbs15Table ();
+	else if (m_type == PatternType::Prbs31)
+		prbs31Jumps ();
+	else
+		shortTable (m_type);
+	seek (0);
+}
+
+void Pattern::seek (uint64_t offset) {
+	m_offset = offset;
+	if (m_type == PatternType::Prbs31)
+		jumpPrbs31 (offset);
+}
+
+void Pattern::jumpPrbs31 (uint64_t offset) {
+	// Springe vom Anfangszustand (alle Bits gesetzt) zum ersten Bit des Bytes, beginnend beim Seed
+	uint64_t bit = (((m_seed % prbs31Period) + (offset % prbs31Period)) % prbs31Period) * 8 % prbs31Period;
+	const Prbs31Jumps& jumps = prbs31Jumps ();
+	m_lfsr = 0x7FFFFFFF;
+	for (unsigned int i = 0; i < 31; ++i)
+		if (bit & (uint64_t { 1 } << i))
+			m_lfsr = Prbs31Jumps::apply (jumps.columns [i], m_lfsr);
+}
+
+void Pattern::fill (unsigned char* buffer, size_t length) {
+	switch (m_type) {
+		case PatternType::Random:
+			fillRandom (buffer, length);
+			break;
+		case PatternType::Prbs7:
+			fillTable (prbs7Table (), buffer, length);
+			break;
+		case PatternType::Prbs15:
+			fillTable (prbs15Table (), buffer, length);
+			break;
+		case PatternType::Prbs31:
+			fillPrbs31 (buffer, length);
+			break;
+		case PatternType::Counter:
+		case PatternType::WalkingOnes:
+		case PatternType::WalkingZeros:
+			fillTable (shortTable (m_type), buffer, length);
+			break;
+		case PatternType::Zeros:
+			std::memset (buffer, 0x00, length);
+			break;
+		case PatternType::Ones:
+			std::memset (buffer, 0xFF, length);
+			break;
+	}
+	m_offset += length;
+}
+
+bool Pattern::verifyReversed (const unsigned char* rx, size_t length, const ReverseKernels& kernels, BlockErrors* errors) {
+	unsigned char expected [verifyChunk];
+	bool ok = true;
+	for (size_t i = 0; i < length; i += verifyChunk) {
+		size_t count = std::min (verifyChunk, length - i);
+		fill (expected, count);
+		// Erzeuge auch nach einem Fehler die restlichen Daten, damit die Position stimmt. Die genaue Analyse
+		// ist langsamer als der Kernel und erfolgt daher nur für fehlerhafte Abschnitte.
+		if ((ok || errors) && !kernels.verify (expected, rx + i, count)) {
+			ok = false;
+			if (errors)
+				errors->merge (analyzeReversed (expected, rx + i, count), i);
+		}
+	}
+	return ok;
+}
+
+void Pattern::fillRandom (unsigned char* buffer, size_t length) {
+	uint64_t index = m_offset / 8;
+	size_t skip = static_cast<size_t> (m_offset % 8), i = 0;
+	// Beginnt der Abschnitt mitten in einem Zufallswert, wird dessen Rest byteweise übernommen
+	if (skip != 0 && length > 0) {
+		uint64_t word = randomWord (m_seed, index++);
+		for (; skip < 8 && i < length; ++skip, ++i)
+			buffer [i] = static_cast<unsigned char> (word >> (8 * skip));
+	}
+	for (; i + 8 <= length; i += 8) {
+		storeLe64 (buffer + i, randomWord (m_seed, index++));
+	}
+	if (i < length) {
+		uint64_t word = randomWord (m_seed, index);
+		for (unsigned int b = 0; i < length; ++b, ++i)
+			buffer [i] = static_cast<unsigned char> (word >> (8 * b));
+	}
+}
+
+void Pattern::fillTable (const std::vector<unsigned char>& table, unsigned char* buffer, size_t length) {
+	// Kopiere abschnittsweise bis zum Ende der Tabelle und beginne dann wieder vorne
+	size_t pos = static_cast<size_t> (((m_seed % table.size ()) + (m_offset % table.size ())) % table.size ());
+	while (length > 0) {
+		size_t count = std::min (length, table.size () - pos);
+		std::memcpy (buffer, table.data () + pos, count);
+		buffer += count;
+		length -= count;
+		pos = 0;
+	}
+}
+
+void Pattern::fillPrbs31 (unsigned char* buffer, size_t length) {
+	// Erzeuge 28 Bits pro Schritt und sammle sie, bis ein Byte voll ist. Am Ende bleiben 0 bis 27 bereits
+	// berechnete Bits übrig. Diese werden verworfen und der Zustand per Sprung auf das nächste Byte gesetzt.
+	uint64_t bits = 0;
+	unsigned int count = 0;
+	size_t i = 0;
+	// Solange Platz ist, werden zwei Schritte auf einmal gemacht und immer 8 Bytes geschrieben, von denen
+	// die gültigen (mindestens 7) übernommen werden
+	for (; i + 8 <= length; ) {
+		bits |= uint64_t { lfsrStep (m_lfsr, 31, 28, 28) } << count;
+		bits |= uint64_t { lfsrStep (m_lfsr, 31, 28, 28) } << (count + 28);
+		count += 56;
+		storeLe64 (buffer + i, bits);
+		unsigned int bytes = count / 8;
+		i += bytes;
+		count -= 8 * bytes;
+		bits >>= 8 * bytes;
+	}
+	for (; i < length; ++i) {
+		if (count < 8) {
+			bits |= uint64_t { lfsrStep (m_lfsr, 31, 28, 28) } << count;
+			count += 28;
+		}
+		buffer [i] = static_cast<unsigned char> (bits);
+		bits >>= 8;
+		count -= 8;
+	}
+	if (count != 0)
+		jumpPrbs31 (m_offset + length);
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PATTERN_HH_
+#define PATTERN_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ReverseKernels;
+struct BlockErrors;
+
+/// Die Arten von Testdaten, die gesendet werden können
+enum class PatternType {
+	/// Pseudo-Zufallszahlen (splitmix64)
+	Random,
+	/// Pseudo-Zufallsbitfolgen nach ITU-T O.150 mit den Polynomen x^7+x^6+1, x^15+x^14+1 bzw. x^31+x^28+1
+	Prbs7, Prbs15, Prbs31,
+	/// Aufsteigend zählende Bytes
+	Counter,
+	/// Ein einzelnes gesetztes bzw. gelöschtes Bit, das von Byte zu Byte eine Stelle weiter wandert
+	WalkingOnes, WalkingZeros,
+	/// Nur 0x00 bzw. nur 0xFF
+	Zeros, Ones
+};
+
+/// Anzahl der Muster in PatternType
+constexpr unsigned int patternCount = static_cast<unsigned int> (PatternType::Ones) + 1;
+
+/// Liefert den Namen des Musters zur Auswahl per Kommandozeile und zur Ausgabe, z.B. "prbs31"
+const char* patternName (PatternType type);
+
+/// Sucht das Muster mit dem gegebenen Namen. Ist der Name unbekannt, wird eine Exception ausgelöst.
+PatternType parsePattern (const std::string& name);
+
+/// Liefert die Namen aller Muster
+std::vector<std::string> patternNames ();
+
+/**
+ * Erzeugt einen endlosen, deterministischen Datenstrom nach einem der Muster aus PatternType. Jedes Byte des
+ * Stroms hängt nur von Muster, Seed und seiner Position ab, sodass sich beliebige Abschnitte per seek direkt
+ * erzeugen lassen. Die Antworten des Geräts können daher mit einer zweiten Instanz geprüft werden, die den
+ * Strom erneut erzeugt, statt die gesendeten Daten bis zum Eintreffen der Antwort aufzubewahren.
+ *
+ * Bei den PRBS-Mustern besteht Byte Nummer n aus den Bits 8n bis 8n+7 der Bitfolge (niederwertigstes Bit zuerst,
+ * wie auf dem Bus), die mit allen Bits gesetzt beginnt; der Seed verschiebt den Anfang um ganze Bytes. PRBS-7 und
+ * PRBS-15 werden aus einmalig berechneten Tabellen über eine volle Periode kopiert. Bei den übrigen Mustern geht
+ * der Seed als Startwert in die Berechnung ein; bei Zeros und Ones wird er ignoriert.
+ */
+class Pattern {
+	public:
+		Pattern (PatternType type, uint64_t seed);
+
+		PatternType type () const { return m_type; }
+		uint64_t seed () const { return m_seed; }
+		/// Position des nächsten zu erzeugenden Bytes im Strom
+		uint64_t offset () const { return m_offset; }
+		/// Setzt die Position des nächsten zu erzeugenden Bytes
+		void seek (uint64_t offset);
+
+		/// Schreibt die nächsten "length" Bytes des Stroms nach "buffer"
+		void fill (unsigned char* buffer, size_t length);
+		/**
+		 * Prüft, ob "rx" die nächsten "length" Bytes des Stroms mit umgedrehten Bits enthält, d.h. die korrekte
+		 * Antwort des Geräts darauf ist. Die erwarteten Daten werden dazu abschnittsweise auf dem Stack erzeugt
+		 * und mit den gegebenen Kernels verglichen. Die Position wird in jedem Fall um "length" weitergeschaltet.
+		 * Ist "errors" angegeben, werden dort für fehlerhafte Abschnitte die genauen Fehler eingetragen.
+		 */
+		bool verifyReversed (const unsigned char* rx, size_t length, const ReverseKernels& kernels, BlockErrors* errors = nullptr);
+	private:
+		void fillRandom (unsigned char* buffer, size_t length);
+		void fillTable (const std::vector<unsigned char>& table, unsigned char* buffer, size_t length);
+		void fillPrbs31 (unsigned char* buffer, size_t length);
+		void jumpPrbs31 (uint64_t offset);
+
+		PatternType m_type;
+		uint64_t m_seed;
+		uint64_t m_offset;
+		/// Bei PRBS-31 die letzten 31 Bits der Folge, das älteste im niederwertigsten Bit
+		uint32_t m_lfsr;
+};
+
+#endif /* PATTERN_HH_ */
@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include "record.hh"
+#include "kernels.hh"
+
+#ifdef _WIN32
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+namespace {
+
+/// Erzeugt eine Exception mit "msg", dem Dateinamen und der Beschreibung des letzten Fehlers des Betriebssystems
+std::runtime_error fileError (const char* msg, const std::string& path) {
+#ifdef _WIN32
+	return std::runtime_error (msg + path + " (Fehler " + std::to_string (GetLastError ()) + ")");
+#else
+	return std::runtime_error (msg + path + " (" + std::strerror (errno) + ")");
+#endif
+}
+
+/// Seitengröße, in deren Abstand die Einträge beim Öffnen einmal beschrieben werden
+constexpr size_t touchStride = 4096;
+
+/// Anzahl Einträge, die RecordReader auf einmal aus der Datei liest
+constexpr size_t readChunk = 4096;
+
+}
+
+constexpr uint64_t RecordLog::defaultCapacity;
+
+bool validRecordHeader (const RecordFileHeader& header) {
+	return std::memcmp (header.magic, recordMagic, sizeof (recordMagic)) == 0 && header.recordSize == sizeof (TransferRecord) && header.capacity > 0;
+}
+
+RecordLog::RecordLog () : m_header (nullptr), m_records (nullptr), m_mappedSize (0), m_clockOffset (0),
+#ifdef _WIN32
+	m_file (INVALID_HANDLE_VALUE), m_mapping (nullptr)
+#else
+	m_fd (-1)
+#endif
+{}
+
+RecordLog::RecordLog (const std::string& path, uint64_t capacity) : RecordLog () {
+	if (capacity == 0 || capacity > (std::numeric_limits<size_t>::max () - sizeof (RecordFileHeader)) / sizeof (TransferRecord))
+		throw std::runtime_error ("Ungültige Kapazität der Aufzeichnung: " + std::to_string (capacity));
+	const size_t size = sizeof (RecordFileHeader) + static_cast<size_t> (capacity) * sizeof (TransferRecord);
+
+	// Eine vorhandene Datei wird nur fortgesetzt, wenn sie eine Aufzeichnung derselben Kapazität ist, und sonst nicht überschrieben
+	RecordFileHeader existing {};
+	uint64_t existingSize = 0;
+	bool existingHeader = false;
+#ifdef _WIN32
+	m_file = CreateFileA (path.c_str (), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+		throw fileError ("Konnte Aufzeichnung nicht öffnen: ", path);
+	const bool created = GetLastError () != ERROR_ALREADY_EXISTS;
+	LARGE_INTEGER fileSize;
+	DWORD read = 0;
+	if (GetFileSizeEx (m_file, &fileSize))
+		existingSize = static_cast<uint64_t> (fileSize.QuadPart);
+	existingHeader = ReadFile (m_file, &existing, sizeof (existing), &read, nullptr) && read == sizeof (existing);
+#else
+	m_fd = ::open (path.c_str (), O_RDWR | O_CREAT | O_EXCL, 0644);
+	const bool created = m_fd >= 0;
+	if (!created && errno == EEXIST)
+		m_fd = ::open (path.c_str (), O_RDWR);
+	if (m_fd < 0)
+		throw fileError ("Konnte Aufzeichnung nicht öffnen: ", path);
+	struct stat st;
+	if (fstat (m_fd, &st) == 0)
+		existingSize = static_cast<uint64_t> (st.st_size);
+	existingHeader = pread (m_fd, &existing, sizeof (existing), 0) == static_cast<ssize_t> (sizeof (existing));
+#endif
+	const bool resume = existingHeader && validRecordHeader (existing);
+	if (existingSize != 0 && !resume) {
+		close ();
+		throw std::runtime_error ("Datei ist keine Aufzeichnung und wird nicht überschrieben: " + path);
+	}
+	if (resume && (existing.capacity != capacity || existingSize != size)) {
+		close ();
+		throw std::runtime_error ("Aufzeichnung " + path + " hat eine andere Kapazität: " + std::to_string (existing.capacity));
+	}
+
+	// Schließt die Datei nach einem Fehler; eine hier neu angelegte wird wieder gelöscht, damit ein späterer Lauf nicht
+	// versucht, eine leere oder unvollständige Datei fortzusetzen. Eine vorher leere Datei wird wieder geleert.
+	auto fail = [&] (const char* msg) {
+		std::runtime_error error = fileError (msg, path);
+		if (!created && !resume) {
+#ifdef _WIN32
+			LARGE_INTEGER begin;
+			begin.QuadPart = 0;
+			if (SetFilePointerEx (m_file, begin, nullptr, FILE_BEGIN))
+				SetEndOfFile (m_file);
+#else
+			if (ftruncate (m_fd, 0) != 0) {
+				// Die Datei bleibt dann ungültig und wird beim nächsten Lauf nicht überschrieben
+			}
+#endif
+		}
+		close ();
+		if (created)
+			std::remove (path.c_str ());
+		return error;
+	};
+
+	// Lege die Datei in voller Größe an und mappe sie
+#ifdef _WIN32
+	LARGE_INTEGER end;
+	end.QuadPart = static_cast<LONGLONG> (size);
+	if (!resume && (!SetFilePointerEx (m_file, end, nullptr, FILE_BEGIN) || !SetEndOfFile (m_file)))
+		throw fail ("Konnte Aufzeichnung nicht anlegen: ");
+	m_mapping = CreateFileMappingA (m_file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+	void* memory = m_mapping ? MapViewOfFile (m_mapping, FILE_MAP_WRITE, 0, 0, size) : nullptr;
+	if (!memory)
+		throw fail ("Konnte Aufzeichnung nicht mappen: ");
+#else
+	if (!resume) {
+		// Reserviere den Platz sofort, damit append nicht erst beim Zurückschreiben an vollem Dateisystem scheitert
+		int res = ftruncate (m_fd, static_cast<off_t> (size));
+#	ifdef __linux__
+		if (res == 0) {
+			res = posix_fallocate (m_fd, 0, static_cast<off_t> (size));
+			// Nicht jedes Dateisystem unterstützt das Reservieren
+			if (res == EOPNOTSUPP || res == EINVAL)
+				res = 0;
+			errno = res;
+		}
+#	endif
+		if (res != 0)
+			throw fail ("Konnte Aufzeichnung nicht anlegen: ");
+	}
+	void* memory = mmap (nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	if (memory == MAP_FAILED)
+		throw fail ("Konnte Aufzeichnung nicht mappen: ");
+#endif
+	m_mappedSize = size;
+	m_header = static_cast<RecordFileHeader*> (memory);
+	m_records = reinterpret_cast<TransferRecord*> (m_header + 1);
+
+	if (!resume) {
+		std::memcpy (m_header->magic, recordMagic, sizeof (recordMagic));
+		m_header->recordSize = sizeof (TransferRecord);
+		m_header->capacity = capacity;
+		m_header->written = 0;
+	}
+	// Beschreibe jede Seite einmal, damit append später keine Seitenfehler auslöst, die auf das Dateisystem warten
+	volatile unsigned char* bytes = static_cast<unsigned char*> (memory);
+	for (size_t offset = 0; offset < size; offset += touchStride)
+		bytes [offset] = bytes [offset];
+
+	m_clockOffset = std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::system_clock::now ().time_since_epoch ()).count ()
+				-	std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+RecordLog::~RecordLog () {
+	close ();
+}
+
+void RecordLog::close () {
+#ifdef _WIN32
+	if (m_header)
+		UnmapViewOfFile (m_header);
+	if (m_mapping)
+		CloseHandle (m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE)
+		CloseHandle (m_file);
+	m_mapping = nullptr;
+	m_file = INVALID_HANDLE_VALUE;
+#else
+	if (m_header)
+		munmap (m_header, m_mappedSize);
+	if (m_fd >= 0)
+		::close (m_fd);
+	m_fd = -1;
+#endif
+	m_header = nullptr;
+	m_records = nullptr;
+}
+
+void RecordLog::appendControl (uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, uint16_t length, int result,
+								const unsigned char* data, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::duration latency) {
+	if (!m_header)
+		return;
+	TransferRecord record {};
+	// Das oberste Bit von bmRequestType gibt wie bei Endpoint-Adressen die Richtung an
+	record.endpoint = requestType & 0x80;
+	record.setup [0] = requestType;
+	record.setup [1] = request;
+	record.setup [2] = static_cast<uint8_t> (value);
+	record.setup [3] = static_cast<uint8_t> (value >> 8);
+	record.setup [4] = static_cast<uint8_t> (index);
+	record.setup [5] = static_cast<uint8_t> (index >> 8);
+	record.setup [6] = static_cast<uint8_t> (length);
+	record.setup [7] = static_cast<uint8_t> (length >> 8);
+	record.requested = length;
+	record.length = result > 0 ? static_cast<uint32_t> (result) : 0;
+	record.status = result < 0 ? result : 0;
+	append (record, data, start, latency);
+}
+
+void RecordLog::appendBulk (uint8_t endpoint, size_t requested, int status, const unsigned char* data, size_t length,
+							std::chrono::steady_clock::time_point start, std::chrono::steady_clock::duration latency, const Pattern* source, uint64_t offset) {
+	if (!m_header)
+		return;
+	TransferRecord record {};
+	record.endpoint = endpoint;
+	record.requested = static_cast<uint32_t> (requested);
+	record.length = static_cast<uint32_t> (length);
+	record.status = status < 0 ? status : 0;
+	if (source) {
+		record.pattern = static_cast<uint8_t> (static_cast<unsigned int> (source->type ()) + 1);
+		record.seed = source->seed ();
+		record.offset = offset;
+	}
+	append (record, data, start, latency);
+}
+
+void RecordLog::append (TransferRecord& record, const unsigned char* data, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::duration latency) {
+	record.timestamp = static_cast<uint64_t> (std::chrono::duration_cast<std::chrono::nanoseconds> (start.time_since_epoch ()).count () + m_clockOffset);
+	const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds> (latency).count ();
+	record.latency = static_cast<uint64_t> (ns < 0 ? 0 : ns);
+	record.digest = record.length > 0 ? crc32c (0, data, record.length) : 0;
+
+	const uint64_t n = m_header->written;
+	m_records [n % m_header->capacity] = record;
+	// Zähle den Eintrag erst, wenn er vollständig ist, damit ein gleichzeitig lesendes Programm keinen halben Eintrag sieht
+	std::atomic_thread_fence (std::memory_order_release);
+	m_header->written = n + 1;
+}
+
+RecordReader::RecordReader (const std::string& path) : m_in (path, std::ios::binary), m_header (), m_chunk (readChunk) {
+	if (!m_in)
+		throw std::runtime_error ("Konnte Aufzeichnung nicht öffnen: " + path);
+	if (!m_in.read (reinterpret_cast<char*> (&m_header), sizeof (m_header)) || !validRecordHeader (m_header))
+		throw std::runtime_error ("Datei ist keine Aufzeichnung (oder eine ältere Version): " + path);
+}
+
+uint64_t RecordReader::count () const {
+	return std::min (m_header.written, m_header.capacity);
+}
+
+size_t RecordReader::read (uint64_t n) {
+	const uint64_t slot = n % m_header.capacity;
+	// Lese bis zum Ende der Datei bzw. des Ringpuffers am Stück
+	const size_t chunk = static_cast<size_t> (std::min<uint64_t> ({ m_chunk.size (), m_header.written - n, m_header.capacity - slot }));
+	m_in.seekg (static_cast<std::streamoff> (sizeof (RecordFileHeader) + slot * sizeof (TransferRecord)));
+	if (!m_in.read (reinterpret_cast<char*> (m_chunk.data ()), static_cast<std::streamsize> (chunk * sizeof (TransferRecord))))
+		throw std::runtime_error ("Aufzeichnung ist unvollständig");
+	return chunk;
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef RECORD_HH_
+#define RECORD_HH_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "pattern.hh"
+
+/**
+ * Ein Eintrag der Aufzeichnung, einer pro Transfer. Die Größe ist fest, damit sich auch Millionen von Einträgen
+ * ohne Parsen direkt ansprechen lassen. Neben dem Ergebnis wird alles festgehalten, was usbreplay zum erneuten
+ * Ausführen des Transfers braucht; von den Daten selbst nur die CRC-32C, bzw. bei per Pattern erzeugten Daten
+ * dessen Parameter. Alle Werte liegen in der Byte-Reihenfolge des aufzeichnenden Rechners vor.
+ */
+struct TransferRecord {
+	/// Beginn des Transfers in Nanosekunden seit 1970 (UTC)
+	uint64_t timestamp;
+	/// Dauer des Transfers in Nanosekunden
+	uint64_t latency;
+	/// Stammen die gesendeten Daten aus einem Pattern (siehe pattern), dessen Seed und die Position des ersten Bytes im Strom
+	uint64_t seed, offset;
+	/// Angeforderte Anzahl Bytes, d.h. Größe des Sende- bzw. Empfangspuffers
+	uint32_t requested;
+	/// Anzahl tatsächlich übertragener Bytes
+	uint32_t length;
+	/// CRC-32C der übertragenen Bytes (siehe crc32c), 0 bei leeren Transfers
+	uint32_t digest;
+	/// Ergebnis des Transfers: 0 bei Erfolg, sonst ein libusb-Fehlercode (LIBUSB_ERROR_*)
+	int32_t status;
+	/// Bei Control-Transfers das Setup-Paket wie auf dem Bus (bmRequestType, bRequest, wValue, wIndex, wLength; Little Endian), sonst 0
+	uint8_t setup [8];
+	/// Adresse des Endpoints inkl. Richtungs-Bit; bei Control-Transfers 0x00 bzw. 0x80 je nach Richtung der Daten
+	uint8_t endpoint;
+	/// PatternType der gesendeten Daten plus 1, bzw. 0 (recordNoPattern), wenn die Daten nicht aus einem Pattern stammen
+	uint8_t pattern;
+	uint8_t reserved [6];
+};
+static_assert (sizeof (TransferRecord) == 64, "TransferRecord muss 64 Bytes groß sein");
+
+/// Wert von TransferRecord::pattern für Transfers, deren Daten nicht aus einem Pattern stammen
+constexpr uint8_t recordNoPattern = 0;
+
+/// Prüft, ob TransferRecord::pattern ein bekanntes Muster angibt; sonst ist die Aufzeichnung beschädigt oder neuer als das Programm
+inline bool recordPatternValid (uint8_t pattern) {
+	return pattern != recordNoPattern && pattern <= patternCount;
+}
+
+/**
+ * Der Kopf der Aufzeichnungsdatei, gefolgt von "capacity" Einträgen. Die Einträge bilden einen Ringpuffer:
+ * Eintrag Nummer n (ab 0 gezählt) liegt an Position n % capacity, sodass nach "written" Einträgen die letzten
+ * min (written, capacity) erhalten sind.
+ */
+struct RecordFileHeader {
+	/// Kennung des Formats, siehe recordMagic
+	char magic [8];
+	/// Größe eines Eintrags in Bytes, sizeof (TransferRecord)
+	uint32_t recordSize;
+	uint32_t reserved0;
+	/// Anzahl Plätze für Einträge
+	uint64_t capacity;
+	/// Anzahl bisher geschriebener Einträge, inkl. überschriebener
+	uint64_t written;
+	uint8_t reserved [32];
+};
+static_assert (sizeof (RecordFileHeader) == 64, "RecordFileHeader muss 64 Bytes groß sein");
+
+/// Die Kennung am Anfang jeder Aufzeichnungsdatei, mit der Version des Formats
+constexpr char recordMagic [8] = { 'U', 'S', 'B', 'R', 'E', 'C', '0', '2' };
+
+/// Prüft, ob "header" zu einer mit dieser Version geschriebenen Aufzeichnung gehört
+bool validRecordHeader (const RecordFileHeader& header);
+
+/**
+ * Schreibt für jeden Transfer einen TransferRecord in eine Datei. Die Datei wird beim Öffnen in voller Größe angelegt
+ * und in den Speicher gemappt, wobei alle Seiten bereits einmal beschrieben werden. appendControl und appendBulk
+ * kopieren den Eintrag danach nur noch in den Speicher, ohne Systemaufruf und ohne auf das Dateisystem zu warten;
+ * das Schreiben auf die Platte übernimmt das Betriebssystem im Hintergrund. Existiert die Datei schon mit derselben Kapazität, wird sie fortgesetzt.
+ * Ein default-konstruiertes RecordLog ist inaktiv und ignoriert alle Einträge.
+ */
+class RecordLog {
+	public:
+		/// Standard-Kapazität in Einträgen, d.h. 64 MiB
+		static constexpr uint64_t defaultCapacity = uint64_t { 1 } << 20;
+
+		RecordLog ();
+		/// Öffnet bzw. erzeugt die Datei "path" mit Platz für "capacity" Einträge; bei Fehlern wird eine Exception ausgelöst
+		RecordLog (const std::string& path, uint64_t capacity);
+		~RecordLog ();
+
+		RecordLog (const RecordLog&) = delete;
+		RecordLog& operator = (const RecordLog&) = delete;
+
+		/// Gibt an, ob Einträge aufgezeichnet werden
+		bool active () const { return m_header != nullptr; }
+
+		/**
+		 * Zeichnet einen Control-Transfer mit dem gegebenen Setup-Paket auf, der zum Zeitpunkt "start" begann, "latency"
+		 * dauerte und "result" (Rückgabewert von libusb_control_transfer) lieferte. Von den übertragenen Bytes ab "data"
+		 * wird nur die CRC-32C festgehalten. Tut nichts, wenn das RecordLog inaktiv ist.
+		 */
+		void appendControl (uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, uint16_t length, int result, const unsigned char* data,
+							std::chrono::steady_clock::time_point start, std::chrono::steady_clock::duration latency);
+		/**
+		 * Zeichnet einen Bulk-Transfer über "endpoint" mit "requested" angeforderten und "length" übertragenen Bytes ab "data"
+		 * auf, der mit "status" (Rückgabewert von libusb_bulk_transfer) endete. Stammen die gesendeten Daten ab Position
+		 * "offset" aus "source", wird dies für usbreplay festgehalten. Tut nichts, wenn das RecordLog inaktiv ist.
+		 */
+		void appendBulk (uint8_t endpoint, size_t requested, int status, const unsigned char* data, size_t length,
+							std::chrono::steady_clock::time_point start, std::chrono::steady_clock::duration latency,
+							const Pattern* source = nullptr, uint64_t offset = 0);
+	private:
+		void close ();
+		/// Ergänzt Zeitstempel, Dauer und CRC-32C und schreibt den Eintrag in den Ringpuffer
+		void append (TransferRecord& record, const unsigned char* data, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::duration latency);
+
+		/// Der gemappte Dateiinhalt, bzw. nullptr wenn inaktiv
+		RecordFileHeader* m_header;
+		TransferRecord* m_records;
+		size_t m_mappedSize;
+		/// Abstand der Systemzeit zur steady_clock in Nanosekunden, um die Zeitstempel ohne weitere Uhr-Abfrage umzurechnen
+		int64_t m_clockOffset;
+#ifdef _WIN32
+		void* m_file;
+		void* m_mapping;
+#else
+		int m_fd;
+#endif
+};
+
+/**
+ * Liest eine per RecordLog erstellte Aufzeichnung. Die Einträge werden abschnittsweise gelesen, sodass auch sehr
+ * große Aufzeichnungen nicht vollständig in den Speicher passen müssen.
+ */
+class RecordReader {
+	public:
+		/// Öffnet die Aufzeichnung "path"; ist sie nicht lesbar oder keine gültige Aufzeichnung, wird eine Exception ausgelöst
+		explicit RecordReader (const std::string& path);
+
+		const RecordFileHeader& header () const { return m_header; }
+		/// Anzahl erhaltener Einträge
+		uint64_t count () const;
+		/// Nummer des ältesten erhaltenen Eintrags; nach einem Überlauf des Ringpuffers wurden die vorherigen überschrieben
+		uint64_t first () const { return m_header.written - count (); }
+
+		/// Ruft "handler" mit Nummer und Inhalt aller erhaltenen Einträge in der Reihenfolge auf, in der sie geschrieben wurden
+		template <typename Handler>
+		void forEach (Handler&& handler) {
+			for (uint64_t n = first (); n < m_header.written; ) {
+				const size_t chunk = read (n);
+				for (size_t i = 0; i < chunk; ++i)
+					handler (n + i, const_cast<const TransferRecord&> (m_chunk [i]));
+				n += chunk;
+			}
+		}
+	private:
+		/// Liest ab Eintrag Nummer "n" möglichst viele Einträge am Stück nach m_chunk und liefert deren Anzahl
+		size_t read (uint64_t n);
+
+		std::ifstream m_in;
+		RecordFileHeader m_header;
+		std::vector<TransferRecord> m_chunk;
+};
+
+#endif /* RECORD_HH_ */
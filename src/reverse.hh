@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef REVERSE_HH_
+#define REVERSE_HH_
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Dreht den übergebenen Integer um. Dies ist die allgemeine Variante, die jedes Bit einzeln verschiebt;
+ * für die üblichen vorzeichenlosen Typen gibt es unten schnellere Spezialisierungen.
+ */
+template <typename T>
+constexpr T reverse (T val) {
+	T temp = 0;
+	// Iteriere jedes Bit
+	for (size_t i = 0; i < CHAR_BIT * sizeof (T); ++i) {
+		// Übernehme unterstes Bit der Eingabe in unterstes Bit der Ausgabe
+		temp = static_cast<T> ((temp << 1) | (val & 1));
+		// Shifte Ausgabe eins nach Links
+		val = static_cast<T> (val >> 1);
+	}
+	return temp;
+}
+
+/// Tabelle mit den umgedrehten Werten aller 256 Bytes
+struct ReverseTable {
+	uint8_t values [256];
+};
+
+/// Erzeugt die ReverseTable zur Compile-Zeit nach demselben Verfahren wie die allgemeine Variante von reverse
+constexpr ReverseTable makeReverseTable () {
+	ReverseTable table {};
+	for (unsigned int i = 0; i < 256; ++i) {
+		unsigned int val = i, temp = 0;
+		for (unsigned int bit = 0; bit < 8; ++bit) {
+			temp = (temp << 1) | (val & 1);
+			val >>= 1;
+		}
+		table.values [i] = static_cast<uint8_t> (temp);
+	}
+	return table;
+}
+
+/// Die zur Compile-Zeit berechnete Tabelle für reverse<uint8_t>
+constexpr ReverseTable reverseTable = makeReverseTable ();
+
+/**
+ * Dreht die Bits innerhalb jedes einzelnen Bytes eines 64-Bit-Worts um, verarbeitet also 8 Bytes auf einmal.
+ * Dazu werden nacheinander benachbarte Bits, Bit-Paare und Nibbles vertauscht.
+ */
+constexpr uint64_t reverseBytewise (uint64_t val) {
+	val = ((val >> 1) & 0x5555555555555555ull) | ((val & 0x5555555555555555ull) << 1);
+	val = ((val >> 2) & 0x3333333333333333ull) | ((val & 0x3333333333333333ull) << 2);
+	val = ((val >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((val & 0x0F0F0F0F0F0F0F0Full) << 4);
+	return val;
+}
+
+/// Dreht ein Byte per Tabelle um.
+template <>
+constexpr uint8_t reverse<uint8_t> (uint8_t val) {
+	return reverseTable.values [val];
+}
+
+/// Dreht ein 16-Bit-Wort um, indem die Bits in jedem Byte umgedreht und die Bytes vertauscht werden.
+template <>
+constexpr uint16_t reverse<uint16_t> (uint16_t val) {
+	return static_cast<uint16_t> (reverseBytewise (static_cast<uint64_t> (static_cast<uint16_t> ((val >> 8) | (val << 8)))));
+}
+
+/// Dreht ein 32-Bit-Wort um, indem die Bits in jedem Byte umgedreht und die Bytes vertauscht werden.
+template <>
+constexpr uint32_t reverse<uint32_t> (uint32_t val) {
+	return static_cast<uint32_t> (reverseBytewise (static_cast<uint64_t> (
+				(val >> 24) | ((val >> 8) & 0xFF00u) | ((val << 8) & 0xFF0000u) | (val << 24))));
+}
+
+/// Dreht ein 64-Bit-Wort um, indem die Bits in jedem Byte umgedreht und die Bytes vertauscht werden.
+template <>
+constexpr uint64_t reverse<uint64_t> (uint64_t val) {
+	return reverseBytewise (
+				(val >> 56) | ((val >> 40) & 0xFF00ull) | ((val >> 24) & 0xFF0000ull) | ((val >> 8) & 0xFF000000ull)
+			|	((val << 8) & 0xFF00000000ull) | ((val << 24) & 0xFF0000000000ull) | ((val << 40) & 0xFF000000000000ull) | (val << 56));
+}
+
+// Prüfe die Spezialisierungen bereits beim Kompilieren
+static_assert (reverse<uint8_t> (0x01) == 0x80 && reverse<uint8_t> (0xC4) == 0x23, "reverse<uint8_t> fehlerhaft");
+static_assert (reverse<uint16_t> (0x1234) == 0x2C48, "reverse<uint16_t> fehlerhaft");
+static_assert (reverse<uint32_t> (0x12345678) == 0x1E6A2C48, "reverse<uint32_t> fehlerhaft");
+static_assert (reverse<uint64_t> (0x0123456789ABCDEFull) == 0xF7B3D591E6A2C480ull, "reverse<uint64_t> fehlerhaft");
+static_assert (reverseBytewise (0x0123456789ABCDEFull) == 0x80C4A2E691D5B3F7ull, "reverseBytewise fehlerhaft");
+
+/**
+ * Prüft, ob jedes der "length" Bytes in "rx" dem umgedrehten Byte an derselben Stelle in "tx" entspricht.
+ * Es werden jeweils 8 Bytes auf einmal mit reverseBytewise verglichen, der Rest per Tabelle.
+ */
+inline bool verifyReversed (const unsigned char* tx, const unsigned char* rx, size_t length) {
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8) {
+		uint64_t txWord, rxWord;
+		// memcpy statt Cast, da die Puffer nicht ausgerichtet sein müssen; wird vom Compiler zu einem Load
+		std::memcpy (&txWord, tx + i, 8);
+		std::memcpy (&rxWord, rx + i, 8);
+		if (reverseBytewise (txWord) != rxWord)
+			return false;
+	}
+	for (; i < length; ++i)
+		if (rx [i] != reverse (tx [i]))
+			return false;
+	return true;
+}
+
+#endif /* REVERSE_HH_ */
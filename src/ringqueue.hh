@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef RINGQUEUE_HH_
+#define RINGQUEUE_HH_
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Eine Warteschlange in einem Ringpuffer, dessen Größe eine Zweierpotenz ist und der nur wächst, wenn er voll ist.
+ * Anders als bei std::deque wird also kein Speicher mehr alloziert oder freigegeben, sobald die größte Füllung einmal
+ * erreicht ist. Nicht threadsicher.
+ */
+template <typename T>
+class RingQueue {
+	public:
+		explicit RingQueue (size_t capacity = 16) : m_buffer (roundCapacity (capacity)), m_head (0), m_size (0) {}
+
+		bool empty () const { return m_size == 0; }
+		size_t size () const { return m_size; }
+
+		/// Das älteste Element
+		T& front () { return m_buffer [m_head]; }
+		const T& front () const { return m_buffer [m_head]; }
+		/// Das Element an Position "index", vom ältesten aus gezählt
+		const T& operator [] (size_t index) const { return m_buffer [(m_head + index) & (m_buffer.size () - 1)]; }
+
+		void push_back (const T& val) {
+			if (m_size == m_buffer.size ())
+				grow ();
+			m_buffer [(m_head + m_size) & (m_buffer.size () - 1)] = val;
+			++m_size;
+		}
+		void pop_front () {
+			m_head = (m_head + 1) & (m_buffer.size () - 1);
+			--m_size;
+		}
+	private:
+		static size_t roundCapacity (size_t capacity) {
+			size_t res = 1;
+			while (res < capacity)
+				res *= 2;
+			return res;
+		}
+		/// Verdoppelt die Kapazität; die Elemente liegen danach ab Position 0
+		void grow () {
+			std::vector<T> buffer (2 * m_buffer.size ());
+			for (size_t i = 0; i < m_size; ++i)
+				buffer [i] = (*this) [i];
+			m_buffer.swap (buffer);
+			m_head = 0;
+		}
+
+		std::vector<T> m_buffer;
+		size_t m_head, m_size;
+};
+
+#endif /* RINGQUEUE_HH_ */
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <cstring>
+#include "simdevice.hh"
+#include "kernels.hh"
+
+namespace {
+
+/// Die String-Deskriptoren 1 bis 3 (Hersteller, Produkt, Seriennummer)
+const char* const simStrings [] = { "ACME Corp.", "Fluxkompensator", "42-1337-47/11" };
+
+/// Kleinste Größe des Ringpuffers für die Antworten
+constexpr size_t minEchoSize = 4096;
+
+/// Zustand eines synchronen Transfers, der über den Simulations-Thread läuft
+struct SyncState {
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool done = false;
+};
+
+/// Callback der synchronen Transfers: weckt den wartenden Thread
+void LIBUSB_CALL syncCallback (libusb_transfer* transfer) {
+	SyncState* state = static_cast<SyncState*> (transfer->user_data);
+	std::lock_guard<std::mutex> lock (state->mutex);
+	state->done = true;
+	state->cond.notify_one ();
+}
+
+}
+
+SimDevice::SimDevice (const SimConfig& config)
+	: m_config (config), m_descriptor (), m_leds (0), m_stop (false), m_echo (minEchoSize), m_echoHead (0), m_echoTail (0) {
+
+	m_descriptor.bLength = LIBUSB_DT_DEVICE_SIZE;
+	m_descriptor.bDescriptorType = LIBUSB_DT_DEVICE;
+	m_descriptor.bcdUSB = 0x0200;
+	m_descriptor.bMaxPacketSize0 = 64;
+	m_descriptor.idVendor = 0xDEAD;
+	m_descriptor.idProduct = 0xBEEF;
+	m_descriptor.bcdDevice = 0x0100;
+	m_descriptor.iManufacturer = 1;
+	m_descriptor.iProduct = 2;
+	m_descriptor.iSerialNumber = 3;
+	m_descriptor.bNumConfigurations = 1;
+
+	// Ein Bulk-Endpoint-Paar auf Interface 0, wie bei der Firmware
+	m_endpoints.bulkOut = EndpointInfo { 0x01, LIBUSB_TRANSFER_TYPE_BULK, 0, 1, config.maxPacketSize };
+	m_endpoints.bulkIn = EndpointInfo { 0x81, LIBUSB_TRANSFER_TYPE_BULK, 0, 1, config.maxPacketSize };
+	m_endpoints.endpoints = { m_endpoints.bulkOut, m_endpoints.bulkIn };
+
+	m_thread = std::thread (&SimDevice::run, this);
+}
+
+SimDevice::~SimDevice () {
+	{
+		std::lock_guard<std::mutex> lock (m_mutex);
+		m_stop = true;
+	}
+	m_cond.notify_one ();
+	m_thread.join ();
+}
+
+int SimDevice::stringDescriptor (uint8_t index, unsigned char* data, int length) {
+	if (index < 1 || index > sizeof (simStrings) / sizeof (simStrings [0]) || length < 0)
+		return LIBUSB_ERROR_INVALID_PARAM;
+	const char* str = simStrings [index - 1];
+	const int count = std::min (static_cast<int> (std::strlen (str)), length);
+	std::memcpy (data, str, static_cast<size_t> (count));
+	return count;
+}
+
+int SimDevice::controlTransfer (uint8_t requestType, uint8_t request, uint16_t value, uint16_t, unsigned char* data, uint16_t length, unsigned int) {
+	if (m_config.latency.count () > 0)
+		std::this_thread::sleep_for (m_config.latency);
+
+	// Vendor-Request 2: Frage LED-Zustand ab
+	if (requestType == 0xC0 && request == 2) {
+		if (length < 1)
+			return 0;
+		data [0] = m_leds.load ();
+		return 1;
+	}
+	// Vendor-Request 1: Setze LED-Zustand aus wValue
+	if (requestType == 0x40 && request == 1) {
+		m_leds = static_cast<uint8_t> (value & 3);
+		return 0;
+	}
+	// Unbekannte Anfragen beantwortet die Firmware mit STALL
+	return LIBUSB_ERROR_PIPE;
+}
+
+int SimDevice::bulkTransfer (uint8_t endpoint, unsigned char* data, int length, int& transferred, unsigned int timeout) {
+	transferred = 0;
+	TransferPtr transfer (libusb_alloc_transfer (0));
+	if (!transfer)
+		return LIBUSB_ERROR_NO_MEM;
+	SyncState state;
+	libusb_fill_bulk_transfer (transfer.get (), nullptr, endpoint, data, length, syncCallback, &state, timeout);
+	int res = submit (transfer.get ());
+	if (res < 0)
+		return res;
+
+	std::unique_lock<std::mutex> lock (state.mutex);
+	state.cond.wait (lock, [&] () { return state.done; });
+	transferred = transfer->actual_length;
+	switch (transfer->status) {
+		case LIBUSB_TRANSFER_COMPLETED:	return 0;
+		case LIBUSB_TRANSFER_TIMED_OUT:	return LIBUSB_ERROR_TIMEOUT;
+		case LIBUSB_TRANSFER_STALL:		return LIBUSB_ERROR_PIPE;
+		case LIBUSB_TRANSFER_OVERFLOW:	return LIBUSB_ERROR_OVERFLOW;
+		default:						return LIBUSB_ERROR_IO;
+	}
+}
+
+int SimDevice::submit (libusb_transfer* transfer) {
+	const bool in = transfer->endpoint == m_endpoints.bulkIn.address;
+	if (!in && transfer->endpoint != m_endpoints.bulkOut.address)
+		return LIBUSB_ERROR_NOT_FOUND;
+	transfer->actual_length = 0;
+	{
+		std::lock_guard<std::mutex> lock (m_mutex);
+		(in ? m_inQueue : m_outQueue).push_back (Pending { transfer, Clock::now () });
+	}
+	m_cond.notify_one ();
+	return LIBUSB_SUCCESS;
+}
+
+SimDevice::Clock::duration SimDevice::busTime (size_t length) const {
+	if (m_config.bandwidth <= 0)
+		return Clock::duration::zero ();
+	return std::chrono::duration_cast<Clock::duration> (std::chrono::duration<double> (static_cast<double> (length) / m_config.bandwidth));
+}
+
+void SimDevice::run () {
+	std::unique_lock<std::mutex> lock (m_mutex);
+	while (!m_stop) {
+		const Clock::time_point now = Clock::now ();
+		// Der nächste Transfer, der den Bus belegt, und der Zeitpunkt, zu dem er frühestens beginnen kann
+		libusb_transfer* next = nullptr;
+		Clock::time_point start = Clock::time_point::max (), wakeup = Clock::time_point::max ();
+		size_t inLength = 0;
+		bool in = false;
+
+		if (!m_inQueue.empty ()) {
+			const Pending& pending = m_inQueue.front ();
+			Clock::time_point ready;
+			if (inReady (pending.transfer, inLength, ready)) {
+				next = pending.transfer;
+				start = std::max ({ m_busFree, pending.submitted, ready });
+				in = true;
+			} else if (pending.transfer->timeout > 0) {
+				// Ohne Antwort läuft der IN-Transfer in den Timeout
+				const Clock::time_point deadline = pending.submitted + std::chrono::milliseconds (pending.transfer->timeout);
+				if (deadline <= now) {
+					libusb_transfer* transfer = pending.transfer;
+					m_inQueue.pop_front ();
+					transfer->status = LIBUSB_TRANSFER_TIMED_OUT;
+					lock.unlock ();
+					transfer->callback (transfer);
+					lock.lock ();
+					continue;
+				}
+				wakeup = deadline;
+			}
+		}
+		// Ist der Puffer der Firmware belegt, muss erst die Antwort abgeholt werden; Null-Pakete belegen keinen Platz
+		if (!m_outQueue.empty () && (m_echoTail - m_echoHead < m_config.bufferSize || m_outQueue.front ().transfer->length == 0 || (!m_inQueue.empty () && !in))) {
+			const Pending& out = m_outQueue.front ();
+			const Clock::time_point outStart = std::max (m_busFree, out.submitted);
+			// Bei Gleichstand wird zuerst die Antwort abgeholt, damit sich keine Daten im Gerät stauen
+			if (outStart < start) {
+				next = out.transfer;
+				start = outStart;
+				in = false;
+			}
+		}
+		// Warte auf neue Transfers oder darauf, dass eine Antwort bereit liegt; ein neuer Transfer weckt den Thread vorher
+		if (!next || start > now) {
+			wakeup = std::min (wakeup, start);
+			if (wakeup == Clock::time_point::max ())
+				m_cond.wait (lock);
+			else
+				m_cond.wait_until (lock, wakeup);
+			continue;
+		}
+
+		// Belege den Bus und führe den Transfer aus
+		const Clock::time_point end = start + busTime (in ? inLength : static_cast<size_t> (next->length));
+		m_busFree = end;
+		if (in) {
+			m_inQueue.pop_front ();
+			processIn (next, inLength);
+		} else {
+			m_outQueue.pop_front ();
+			processOut (next, end);
+		}
+		next->status = LIBUSB_TRANSFER_COMPLETED;
+
+		lock.unlock ();
+		if (end > Clock::now ())
+			std::this_thread::sleep_until (end);
+		next->callback (next);
+		lock.lock ();
+	}
+}
+
+void SimDevice::processOut (libusb_transfer* out, Clock::time_point end) {
+	const size_t length = static_cast<size_t> (out->length);
+	// Vergrößere den Ringpuffer bei Bedarf auf die nächste Zweierpotenz und lege den Inhalt dabei an den Anfang
+	const size_t used = m_echoTail - m_echoHead;
+	if (used + length > m_echo.size ()) {
+		size_t size = m_echo.size ();
+		while (size < used + length)
+			size *= 2;
+		std::vector<unsigned char> echo (size);
+		const size_t head = m_echoHead & (m_echo.size () - 1), first = std::min (used, m_echo.size () - head);
+		std::memcpy (echo.data (), m_echo.data () + head, first);
+		std::memcpy (echo.data () + first, m_echo.data (), used - first);
+		m_echo.swap (echo);
+		m_echoHead = 0;
+		m_echoTail = used;
+	}
+
+	// Die Firmware dreht die Bits jedes Bytes um
+	const ReverseKernels& kernels = reverseKernels ();
+	const size_t tail = m_echoTail & (m_echo.size () - 1), first = std::min (length, m_echo.size () - tail);
+	kernels.reverse (out->buffer, m_echo.data () + tail, first);
+	kernels.reverse (out->buffer + first, m_echo.data (), length - first);
+	m_echoTail += length;
+
+	const bool zlp = (out->flags & LIBUSB_TRANSFER_ADD_ZERO_PACKET) != 0;
+	m_chunks.push_back (Chunk { end + m_config.latency, length, length == 0 || length % m_config.maxPacketSize != 0 || zlp });
+	out->actual_length = out->length;
+}
+
+bool SimDevice::inReady (const libusb_transfer* in, size_t& length, Clock::time_point& ready) const {
+	const size_t wanted = static_cast<size_t> (in->length);
+	size_t available = 0;
+	ready = Clock::time_point::min ();
+	for (size_t i = 0; i < m_chunks.size (); ++i) {
+		const Chunk& chunk = m_chunks [i];
+		available += chunk.remaining;
+		ready = std::max (ready, chunk.ready);
+		// Der Transfer endet, wenn der Puffer voll ist oder ein kurzes Paket ankommt
+		if (available >= wanted || chunk.terminated) {
+			length = std::min (available, wanted);
+			return true;
+		}
+	}
+	return false;
+}
+
+void SimDevice::processIn (libusb_transfer* in, size_t length) {
+	const size_t head = m_echoHead & (m_echo.size () - 1), first = std::min (length, m_echo.size () - head);
+	std::memcpy (in->buffer, m_echo.data () + head, first);
+	std::memcpy (in->buffer + first, m_echo.data (), length - first);
+	m_echoHead += length;
+	in->actual_length = static_cast<int> (length);
+
+	// Entferne die abgeholten Antworten. Ist der Puffer nicht voll, endete der Transfer mit dem Ende einer Antwort,
+	// die dann auch entfernt wird, wenn sie (als Null-Paket) keine Bytes mehr enthält.
+	const bool shortTransfer = length < static_cast<size_t> (in->length);
+	while (!m_chunks.empty ()) {
+		Chunk& chunk = m_chunks.front ();
+		const size_t n = std::min (length, chunk.remaining);
+		chunk.remaining -= n;
+		length -= n;
+		if (chunk.remaining > 0 || (length == 0 && !shortTransfer && n == 0))
+			break;
+		const bool terminated = chunk.terminated;
+		m_chunks.pop_front ();
+		if (terminated || (length == 0 && !shortTransfer))
+			break;
+	}
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef SIMDEVICE_HH_
+#define SIMDEVICE_HH_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "device.hh"
+#include "ringqueue.hh"
+
+/// Parameter des simulierten Geräts
+struct SimConfig {
+	/// Paketgröße der Bulk-Endpoints; 64 entspricht Full-Speed
+	uint16_t maxPacketSize = 64;
+	/// Verarbeitungszeit der Firmware: vom Ende eines OUT-Transfers, bis die Antwort abgeholt werden kann, bzw. Dauer eines Control-Transfers
+	std::chrono::nanoseconds latency { 0 };
+	/// Übertragungsrate des Busses in Bytes pro Sekunde, die sich beide Richtungen teilen; 0 für unbegrenzt
+	double bandwidth = 0;
+	/**
+	 * Größe des Puffers der Firmware für die Antworten in Bytes. Ist er belegt, nimmt das Gerät (wie per NAK) keine
+	 * weiteren Daten an, bis die Antworten abgeholt wurden, außer ein IN-Transfer wartet noch auf Daten.
+	 */
+	size_t bufferSize = 64;
+};
+
+/**
+ * Simuliert die f1usb-Firmware im selben Prozess, um den Host-seitigen Ablauf (Erzeugung, Warteschlangen, Prüfung)
+ * ohne Hardware testen und messen zu können. Das Gerät meldet sich mit VID:PID DEAD:BEEF und den String-Deskriptoren
+ * des Beispiels aus der README, speichert den per Vendor-Request 1 gesetzten LED-Zustand und liefert ihn per
+ * Vendor-Request 2, und schickt die an den Bulk-OUT-Endpoint gesendeten Daten mit umgedrehten Bits am Bulk-IN-Endpoint
+ * zurück, sobald im Puffer der Firmware Platz ist. Die Paketgrenzen bleiben dabei erhalten: Endet ein OUT-Transfer mit einem kurzen oder einem Null-Paket,
+ * endet auch der IN-Transfer, der dessen letzte Bytes empfängt.
+ *
+ * Ein eigener Thread arbeitet die Transfers beider Endpoints in der Reihenfolge ab, in der sie abgeschickt wurden,
+ * und ruft danach ihre Callbacks auf, wie sonst der Event-Thread von libusb. Die Zeit wird dabei über einen virtuellen
+ * Bus nachgebildet, den immer nur ein Transfer belegt, für die Dauer Länge / SimConfig::bandwidth; der Thread wartet
+ * bis zum berechneten Ende jedes Transfers. Da die Zeitpunkte aufeinander aufbauen statt auf der tatsächlichen Uhrzeit,
+ * verfälscht zu langes Warten die mittlere Übertragungsrate nicht. Die synchronen Bulk-Transfers laufen ebenfalls über
+ * diesen Thread.
+ */
+class SimDevice : public Device {
+	public:
+		explicit SimDevice (const SimConfig& config);
+		~SimDevice ();
+
+		const char* backend () const override { return "sim"; }
+		const libusb_device_descriptor& descriptor () const override { return m_descriptor; }
+		const EndpointTable& endpoints () const override { return m_endpoints; }
+		libusb_device_handle* handle () const override { return nullptr; }
+
+		int stringDescriptor (uint8_t index, unsigned char* data, int length) override;
+		int controlTransfer (uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, unsigned char* data, uint16_t length,
+								unsigned int timeout) override;
+		int bulkTransfer (uint8_t endpoint, unsigned char* data, int length, int& transferred, unsigned int timeout) override;
+
+		void startEventHandling () override {}
+		int submit (libusb_transfer* transfer) override;
+		void check () const override {}
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		/// Ein abgeschickter, noch nicht bearbeiteter Transfer
+		struct Pending {
+			libusb_transfer* transfer;
+			Clock::time_point submitted;
+		};
+		/// Die Antwort auf einen OUT-Transfer, deren Bytes im Ringpuffer m_echo liegen
+		struct Chunk {
+			/// Ab diesem Zeitpunkt kann die Antwort abgeholt werden
+			Clock::time_point ready;
+			/// Anzahl noch nicht abgeholter Bytes
+			size_t remaining;
+			/// Gibt an, ob die Antwort mit einem kurzen oder einem Null-Paket endet
+			bool terminated;
+		};
+
+		void run ();
+		/// Bearbeitet den OUT-Transfer "out", der den Bus bis "end" belegt
+		void processOut (libusb_transfer* out, Clock::time_point end);
+		/**
+		 * Prüft, ob der IN-Transfer "in" mit den vorliegenden Antworten abgeschlossen werden kann, und liefert ggf. die
+		 * Anzahl Bytes und den Zeitpunkt, ab dem das letzte davon bereit liegt.
+		 */
+		bool inReady (const libusb_transfer* in, size_t& length, Clock::time_point& ready) const;
+		/// Kopiert "length" Bytes der Antworten in den Puffer von "in"
+		void processIn (libusb_transfer* in, size_t length);
+		/// Dauer der Übertragung von "length" Bytes über den virtuellen Bus
+		Clock::duration busTime (size_t length) const;
+
+		const SimConfig m_config;
+		libusb_device_descriptor m_descriptor;
+		EndpointTable m_endpoints;
+		/// Der per Vendor-Request gesetzte LED-Zustand
+		std::atomic<uint8_t> m_leds;
+
+		/// Schützt alle folgenden Elemente
+		std::mutex m_mutex;
+		std::condition_variable m_cond;
+		bool m_stop;
+		/// Die ausstehenden Transfers je Richtung
+		RingQueue<Pending> m_outQueue, m_inQueue;
+		/// Ringpuffer der umgedrehten, noch nicht abgeholten Bytes; die Größe ist eine Zweierpotenz
+		std::vector<unsigned char> m_echo;
+		/// Fortlaufende Position des nächsten zu lesenden bzw. zu schreibenden Bytes in m_echo
+		size_t m_echoHead, m_echoTail;
+		/// Die Antworten in m_echo, die älteste zuerst
+		RingQueue<Chunk> m_chunks;
+		/// Zeitpunkt, ab dem der virtuelle Bus wieder frei ist
+		Clock::time_point m_busFree;
+
+		std::thread m_thread;
+};
+
+#endif /* SIMDEVICE_HH_ */
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SPSCQUEUE_HH_
+#define SPSCQUEUE_HH_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+/**
+ * Eine lock-freie Warteschlange fester Kapazität für genau einen schreibenden ("Producer") und genau einen
+ * lesenden Thread ("Consumer"). Die Elemente liegen in einem Ringpuffer, dessen Größe eine Zweierpotenz ist;
+ * Lese- und Schreibposition sind Zähler, die nur vom jeweiligen Thread geschrieben werden.
+ */
+template <typename T>
+class SpscQueue {
+	public:
+		/// Legt die Warteschlange an; die Kapazität wird auf die nächste Zweierpotenz aufgerundet.
+		explicit SpscQueue (size_t capacity) : m_mask (roundCapacity (capacity) - 1), m_buffer (new T [m_mask + 1]), m_head (0), m_tail (0) {}
+
+		SpscQueue (const SpscQueue&) = delete;
+		SpscQueue& operator = (const SpscQueue&) = delete;
+
+		/// Hängt ein Element an. Darf nur vom Producer aufgerufen werden. Liefert false, wenn die Warteschlange voll ist.
+		bool push (const T& val) {
+			size_t tail = m_tail.load (std::memory_order_relaxed);
+			if (tail - m_head.load (std::memory_order_acquire) > m_mask)
+				return false;
+			m_buffer [tail & m_mask] = val;
+			m_tail.store (tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		/// Entnimmt das älteste Element. Darf nur vom Consumer aufgerufen werden. Liefert false, wenn die Warteschlange leer ist.
+		bool pop (T& val) {
+			size_t head = m_head.load (std::memory_order_relaxed);
+			if (head == m_tail.load (std::memory_order_acquire))
+				return false;
+			val = m_buffer [head & m_mask];
+			m_head.store (head + 1, std::memory_order_release);
+			return true;
+		}
+
+		/// Prüft, ob die Warteschlange leer ist. Aus Sicht des Producers ist das Ergebnis nur eine Momentaufnahme.
+		bool empty () const {
+			return m_head.load (std::memory_order_acquire) == m_tail.load (std::memory_order_acquire);
+		}
+
+		/// Die tatsächliche Kapazität
+		size_t capacity () const { return m_mask + 1; }
+	private:
+		static size_t roundCapacity (size_t capacity) {
+			size_t res = 1;
+			while (res < capacity)
+				res <<= 1;
+			return res;
+		}
+
+		const size_t m_mask;
+		const std::unique_ptr<T []> m_buffer;
+
+		// Die Positionen liegen in getrennten Cache-Lines, damit Producer und Consumer sich nicht gegenseitig ausbremsen.
+		// Explizites Auffüllen statt alignas, da "new" vor C++17 keine erweiterte Ausrichtung garantiert.
+		char m_pad0 [64];
+		/// Lese-Position, wird nur vom Consumer geschrieben
+		std::atomic<size_t> m_head;
+		char m_pad1 [64 - sizeof (std::atomic<size_t>)];
+		/// Schreib-Position, wird nur vom Producer geschrieben
+		std::atomic<size_t> m_tail;
+		char m_pad2 [64 - sizeof (std::atomic<size_t>)];
+};
+
+#endif /* SPSCQUEUE_HH_ */
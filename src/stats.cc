@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include "stats.hh"
+
+StatsReporter::StatsReporter (const StreamCounters& counters, std::ostream& out, std::chrono::milliseconds interval)
+	: m_counters (counters), m_out (out), m_interval (interval), m_stop (false) {
+	m_thread = std::thread (&StatsReporter::run, this);
+}
+
+StatsReporter::~StatsReporter () {
+	{
+		std::lock_guard<std::mutex> lock (m_mutex);
+		m_stop = true;
+	}
+	m_cond.notify_one ();
+	m_thread.join ();
+}
+
+void StatsReporter::run () {
+	const auto start = std::chrono::steady_clock::now ();
+	auto last = start;
+	uint64_t lastBytes = 0, lastTransfers = 0;
+
+	std::unique_lock<std::mutex> lock (m_mutex);
+	// Feste Zeitpunkte statt fester Wartezeiten, damit sich die Abstände nicht durch die Ausgabe verschieben
+	for (auto next = start + m_interval; !m_cond.wait_until (lock, next, [this] () { return m_stop; }); next += m_interval) {
+		const auto now = std::chrono::steady_clock::now ();
+		const double seconds = std::chrono::duration<double> (now - last).count ();
+		const uint64_t bytes = m_counters.bytes.get (), transfers = m_counters.transfers.get ();
+
+		char line [160];
+		std::snprintf (line, sizeof (line), "[%7.1f s] %9.3f MB/s, %8.0f Transfers/s, Fehler: %llu, Timeouts: %llu, Stalls: %llu\n",
+				std::chrono::duration<double> (now - start).count (),
+				static_cast<double> (bytes - lastBytes) / seconds / 1e6, static_cast<double> (transfers - lastTransfers) / seconds,
+				static_cast<unsigned long long> (m_counters.mismatches.get ()), static_cast<unsigned long long> (m_counters.timeouts.get ()),
+				static_cast<unsigned long long> (m_counters.stalls.get ()));
+		m_out << line << std::flush;
+
+		last = now;
+		lastBytes = bytes;
+		lastTransfers = transfers;
+	}
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STATS_HH_
+#define STATS_HH_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+/**
+ * Ein Zähler, der von genau einem Thread erhöht und von beliebigen anderen Threads gelesen wird. Da es nur einen
+ * schreibenden Thread gibt, genügen ein einfaches Laden und Speichern statt eines atomaren Read-Modify-Write,
+ * sodass das Zählen im Transfer-Pfad nicht mehr kostet als bei einer normalen Variablen.
+ */
+class StatCounter {
+	public:
+		StatCounter () : m_value (0) {}
+
+		/// Erhöht den Zähler. Darf nur vom schreibenden Thread aufgerufen werden.
+		void add (uint64_t n = 1) { m_value.store (m_value.load (std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+		/// Liefert den aktuellen Stand
+		uint64_t get () const { return m_value.load (std::memory_order_relaxed); }
+	private:
+		std::atomic<uint64_t> m_value;
+};
+
+/// Die fortlaufenden Zähler eines Laufs im Streaming-Modus, die während des Laufs von anderen Threads gelesen werden können
+struct StreamCounters {
+	/// Anzahl zurück empfangener Bytes
+	StatCounter bytes;
+	/// Anzahl vollständig gesendeter und zurück empfangener Blöcke
+	StatCounter transfers;
+	/// Anzahl Blöcke, deren Antwort nicht korrekt war
+	StatCounter mismatches;
+	/// Anzahl Transfers, die wegen Zeitüberschreitung abgebrochen wurden
+	StatCounter timeouts;
+	/// Anzahl Transfers, die das Gerät mit STALL abgelehnt hat
+	StatCounter stalls;
+};
+
+/**
+ * Gibt in einem eigenen Thread in festen Abständen eine Zeile mit den Raten und Fehlerzahlen seit dem Start
+ * aus, sodass die Ausgabe auf der Konsole nie den Transfer-Pfad aufhält. Der Thread wird im Konstruktor
+ * gestartet und im Destruktor beendet.
+ */
+class StatsReporter {
+	public:
+		StatsReporter (const StreamCounters& counters, std::ostream& out, std::chrono::milliseconds interval = std::chrono::seconds (1));
+		~StatsReporter ();
+
+		StatsReporter (const StatsReporter&) = delete;
+		StatsReporter& operator = (const StatsReporter&) = delete;
+	private:
+		void run ();
+
+		const StreamCounters& m_counters;
+		std::ostream& m_out;
+		const std::chrono::milliseconds m_interval;
+
+		std::mutex m_mutex;
+		std::condition_variable m_cond;
+		/// Wird zum Beenden des Threads gesetzt
+		bool m_stop;
+		std::thread m_thread;
+};
+
+#endif /* STATS_HH_ */
@@ -0,0 +1,529 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "stream.hh"
+#include "usb.hh"
+#include "eventloop.hh"
+#include "device.hh"
+#include "transferpool.hh"
+#include "kernels.hh"
+#include "stats.hh"
+#include "taskpool.hh"
+
+namespace {
+
+/// Timeout für die einzelnen Transfers in Millisekunden, damit ein hängendes Gerät den Lauf beendet
+constexpr unsigned int transferTimeout = 1000;
+
+/**
+ * Verwaltet die asynchronen Transfers des Streaming-Modus als Pipeline. Die Blöcke durchlaufen nacheinander die
+ * Stufen "erzeugt", "gesendet" (OUT), "empfangen" (IN) und "geprüft", wobei jede Stufe über eine fortlaufende
+ * Block-Nummer verfolgt wird. Jeder Block wird direkt im Puffer eines OUT-Transfers erzeugt, der bis zum Abschicken
+ * im Ringpuffer m_blocks verbleibt. OUT- und IN-Transfers werden unabhängig voneinander mit jeweils bis zu
+ * config.queueDepth ausstehenden Transfers abgeschickt. Da libusb die Transfers eines Endpoints in der Reihenfolge
+ * abschließt, in der sie abgeschickt wurden, gehört jeder abgeschlossene IN-Transfer zum ältesten noch nicht
+ * geprüften Block. Die gesendeten Daten werden nicht aufbewahrt: Ein zweites Pattern erzeugt den Datenstrom zur
+ * Prüfung erneut, sodass ein OUT-Transfer direkt nach seinem Abschluss wiederverwendet werden kann. Bei
+ * VerifyMode::Digest wird stattdessen beim Erzeugen die CRC-32C der erwarteten Antwort im Ringpuffer m_digests abgelegt;
+ * dessen Größe begrenzt, wie weit die Erzeugung der Prüfung vorauslaufen darf.
+ *
+ * Nach jedem abgeschlossenen Transfer werden zuerst die freigewordenen Transfers mit bereits erzeugten Blöcken
+ * neu abgeschickt, und erst danach wird der empfangene Block geprüft und der Puffer mit neuen Daten gefüllt.
+ * Während Block N geprüft wird, ist Block N+1 also bereits auf dem Bus und Block N+2 fertig erzeugt, sodass der
+ * Durchsatz nur durch die USB-Verbindung und nicht durch die Summe aus Übertragungs- und Rechenzeit begrenzt ist.
+ *
+ * Alle Transfers und Puffer stammen aus TransferPools, die im Konstruktor gefüllt werden; während des Laufs
+ * finden keine Heap-Allokationen statt. Die Callbacks laufen im Event-Thread und reichen die Transfers nur an
+ * die CompletionQueue weiter; Prüfung und erneutes Abschicken erfolgen im Thread, der die Queue leert. Mehrere
+ * Streams können sich eine Queue teilen, der Thread gibt jeden Transfer per dispatch an seinen Stream weiter.
+ */
+class Stream {
+	public:
+		Stream (Device& device, const StreamConfig& config, StreamCounters& counters, CompletionQueue& completions);
+
+		/// Startet die Laufzeit und füllt die Pipeline
+		void start ();
+		/// Beendet nach Ablauf der Laufzeit das Senden neuer Blöcke und liefert, ob noch Transfers ausstehen
+		bool active ();
+		/// Füllt das Ergebnis und löst eine Exception aus, falls ein Transfer fehlgeschlagen ist. Es darf kein Transfer mehr ausstehen.
+		StreamResult finish ();
+		/// Schickt keine neuen Transfers mehr ab, z.B. weil der Lauf nach einer Exception abgebrochen wird (siehe drain)
+		void abort ();
+
+		/// Übergibt einen aus der CompletionQueue entnommenen Transfer an den Stream, zu dem er gehört
+		static void dispatch (libusb_transfer* transfer);
+	private:
+		static void LIBUSB_CALL callback (libusb_transfer* transfer);
+
+		void submitReady ();
+		void pump ();
+		void generate (libusb_transfer* out);
+		void verify (libusb_transfer* in);
+		void onComplete (libusb_transfer* transfer);
+		bool submit (libusb_transfer* transfer);
+		void fail (const char* msg, int code);
+
+		Device& m_device;
+		const StreamConfig& m_config;
+		CompletionQueue& m_completions;
+		/// Die zur Prüfung genutzten Kernel, einmalig ausgewählt
+		const ReverseKernels& m_kernels;
+
+		/// Die OUT-Transfers: einer mehr als ausstehen dürfen, damit immer ein Block im Voraus erzeugt werden kann
+		TransferPool m_outPool;
+		/// Die IN-Transfers: einer mehr als ausstehen dürfen, damit vor der Prüfung eines Blocks schon der nächste abgeschickt werden kann
+		TransferPool m_inPool;
+		/// Ringpuffer der OUT-Transfers der erzeugten Blöcke; Block Nummer n liegt an Position n % m_blocks.size ()
+		std::vector<libusb_transfer*> m_blocks;
+		/// Bei VerifyMode::Digest die CRC-32C der erwarteten Antworten aller erzeugten, noch nicht geprüften Blöcke, analog zu m_blocks
+		std::vector<uint32_t> m_digests;
+
+		/// Nummer des nächsten zu erzeugenden, zu sendenden, zu empfangenden bzw. zu prüfenden Blocks
+		uint64_t m_genSeq, m_outSeq, m_inSeq, m_verifySeq;
+		/// Anzahl ausstehender OUT- bzw. IN-Transfers
+		unsigned int m_outPending, m_inPending;
+
+		/// Erzeugt die gesendeten Daten
+		Pattern m_txPattern;
+		/// Erzeugt dieselben Daten erneut zur Prüfung der Antworten
+		Pattern m_rxPattern;
+
+		/// Beginn und geplantes Ende der Laufzeit
+		std::chrono::steady_clock::time_point m_start, m_end;
+		/// Wird gesetzt, sobald keine neuen Blöcke mehr gesendet werden sollen
+		bool m_stopping;
+		/// Fehlermeldung des ersten fehlgeschlagenen Transfers
+		std::string m_error;
+		StreamResult m_result;
+		/// Die fortlaufenden Zähler, aus denen am Ende auch m_result gefüllt wird
+		StreamCounters& m_counters;
+};
+
+Stream::Stream (Device& device, const StreamConfig& config, StreamCounters& counters, CompletionQueue& completions)
+	: m_device (device), m_config (config), m_completions (completions), m_kernels (reverseKernels ()),
+	  // Neben den ausstehenden OUT-Transfers wird ein Block im Voraus erzeugt
+	  m_outPool (device.handle (), device.endpoints ().bulkOut.address, config.transferSize, config.queueDepth + 1, callback, this, transferTimeout,
+				config.zlp ? LIBUSB_TRANSFER_ADD_ZERO_PACKET : 0),
+	  m_inPool (device.handle (), device.endpoints ().bulkIn.address, echoInLength (config.transferSize, device.endpoints ().bulkIn.maxPacketSize, config.zlp),
+				config.queueDepth + 1, callback, this, transferTimeout),
+	  m_blocks (config.queueDepth + 1),
+	  // Neben den ausstehenden OUT- und IN-Transfers können noch Blöcke gesendet, aber nicht angefordert sein
+	  m_digests (config.verify == VerifyMode::Digest ? 2 * config.queueDepth + 2 : 0),
+	  m_genSeq (0), m_outSeq (0), m_inSeq (0), m_verifySeq (0), m_outPending (0), m_inPending (0),
+	  m_txPattern (config.pattern, config.seed), m_rxPattern (config.pattern, config.seed),
+	  m_stopping (false), m_counters (counters) {
+
+	m_result.deviceMemory = m_outPool.deviceMemory () && m_inPool.deviceMemory ();
+	m_device.startEventHandling ();
+}
+
+void Stream::start () {
+	m_start = std::chrono::steady_clock::now ();
+	m_end = m_start + std::chrono::duration_cast<std::chrono::steady_clock::duration> (std::chrono::duration<double> (m_config.duration));
+
+	// Fülle die Pipeline
+	pump ();
+}
+
+bool Stream::active () {
+	// Nach Ablauf der Laufzeit werden keine neuen Blöcke mehr gesendet, die ausstehenden aber noch ausgewertet
+	if (!m_stopping && std::chrono::steady_clock::now () >= m_end)
+		m_stopping = true;
+	// Ohne Event-Thread würden die ausstehenden Transfers nie abgeschlossen
+	m_device.check ();
+	return m_outPending + m_inPending > 0;
+}
+
+StreamResult Stream::finish () {
+	// Der Event-Thread kann nach dem letzten Transfer noch in push sein
+	m_completions.waitForProducers ();
+	m_result.seconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - m_start).count ();
+	m_result.blocks = m_counters.transfers.get ();
+	m_result.bytes = m_counters.bytes.get ();
+	m_result.mismatches = m_counters.mismatches.get ();
+
+	if (!m_error.empty ())
+		throw std::runtime_error (m_error);
+
+	return m_result;
+}
+
+void Stream::abort () {
+	m_stopping = true;
+	// submitReady fordert danach auch keine Antworten mehr an
+	if (m_error.empty ())
+		m_error = "Lauf abgebrochen";
+}
+
+void Stream::dispatch (libusb_transfer* transfer) {
+	static_cast<Stream*> (transfer->user_data)->onComplete (transfer);
+}
+
+void Stream::submitReady () {
+	// Nach einem Fehler ist die Zuordnung der Antworten zu den Blöcken nicht mehr sicher
+	if (!m_error.empty ())
+		return;
+
+	// Sende bereits erzeugte Blöcke
+	while (!m_stopping && m_outPending < m_config.queueDepth && m_outSeq < m_genSeq) {
+		if (!submit (m_blocks [m_outSeq % m_blocks.size ()]))
+			return;
+		++m_outPending;
+		++m_outSeq;
+	}
+	// Fordere die Antworten auf gesendete Blöcke an. Auch nach Ablauf der Laufzeit, damit keine Daten im Gerät verbleiben.
+	while (m_inPending < m_config.queueDepth && m_inSeq < m_outSeq) {
+		libusb_transfer* in = m_inPool.acquire ();
+		if (!in || !submit (in))
+			return;
+		++m_inPending;
+		++m_inSeq;
+	}
+}
+
+void Stream::pump () {
+	submitReady ();
+	// Erzeuge neue Blöcke in freien OUT-Transfers, und schicke jeden sofort ab, falls die Warteschlange nicht voll ist
+	while (!m_stopping && m_error.empty ()) {
+		// Jeder noch nicht geprüfte Block belegt einen Platz in m_digests
+		if (!m_digests.empty () && m_genSeq - m_verifySeq >= m_digests.size ())
+			break;
+		libusb_transfer* out = m_outPool.acquire ();
+		if (!out)
+			break;
+		generate (out);
+		m_blocks [m_genSeq % m_blocks.size ()] = out;
+		++m_genSeq;
+		submitReady ();
+	}
+}
+
+void Stream::generate (libusb_transfer* out) {
+	// Fülle Sendepuffer mit den nächsten Daten des Musters
+	m_txPattern.fill (out->buffer, static_cast<size_t> (out->length));
+	if (!m_digests.empty ())
+		m_digests [m_genSeq % m_digests.size ()] = crc32cReversed (0, out->buffer, static_cast<size_t> (out->length));
+}
+
+bool Stream::submit (libusb_transfer* transfer) {
+	int res = m_device.submit (transfer);
+	if (res < 0) {
+		fail ((transfer->endpoint & LIBUSB_ENDPOINT_IN) ? "IN Transfer konnte nicht abgeschickt werden: " : "OUT Transfer konnte nicht abgeschickt werden: ", res);
+		return false;
+	}
+	return true;
+}
+
+void LIBUSB_CALL Stream::callback (libusb_transfer* transfer) {
+	// Läuft im Event-Thread; die Auswertung übernimmt der Worker
+	static_cast<Stream*> (transfer->user_data)->m_completions.push (transfer);
+}
+
+void Stream::onComplete (libusb_transfer* transfer) {
+	bool in = (transfer->endpoint & LIBUSB_ENDPOINT_IN) != 0;
+	--(in ? m_inPending : m_outPending);
+
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		if (transfer->status == LIBUSB_TRANSFER_TIMED_OUT)
+			m_counters.timeouts.add ();
+		else if (transfer->status == LIBUSB_TRANSFER_STALL)
+			m_counters.stalls.add ();
+		fail (in ? "IN Transfer fehlgeschlagen: " : "OUT Transfer fehlgeschlagen: ", transfer->status);
+		return;
+	}
+	if (!in) {
+		// Die Daten werden zur Prüfung neu erzeugt, der Transfer ist also sofort wieder frei
+		m_outPool.release (transfer);
+		pump ();
+		return;
+	}
+
+	// Der IN-Transfer gehört zum ältesten ungeprüften Block. Halte den Bus beschäftigt, bevor er geprüft wird.
+	submitReady ();
+	verify (transfer);
+	++m_verifySeq;
+
+	m_inPool.release (transfer);
+	pump ();
+}
+
+void Stream::verify (libusb_transfer* in) {
+	// Prüfe ob alle empfangenen Bytes korrekt gedreht wurden und die Antwort vollständig ist. Das Pattern wird dabei
+	// in jedem Fall um einen Block weitergeschaltet, damit auch nach einer unvollständigen Antwort die weiteren Blöcke passen.
+	const size_t length = m_config.transferSize, received = static_cast<size_t> (in->actual_length);
+	if (!m_digests.empty ()) {
+		// Die CRC-32C zeigt nur, ob die Antwort stimmt, daher bleibt m_result.errors leer und m_rxPattern ungenutzt
+		const bool ok = received == length && crc32c (0, in->buffer, length) == m_digests [m_verifySeq % m_digests.size ()];
+		m_counters.transfers.add ();
+		m_counters.bytes.add (received);
+		if (!ok)
+			m_counters.mismatches.add ();
+		return;
+	}
+	BlockErrors errors;
+	m_rxPattern.verifyReversed (in->buffer, std::min (received, length), m_kernels, &errors);
+	if (received < length) {
+		m_rxPattern.seek (m_rxPattern.offset () + (length - received));
+		addLengthMismatch (errors, received, length - received);
+	} else
+		addLengthMismatch (errors, length, received - length);
+
+	m_counters.transfers.add ();
+	m_counters.bytes.add (received);
+	if (!errors.ok ())
+		m_counters.mismatches.add ();
+	m_result.errors.add (m_verifySeq, length, errors);
+}
+
+void Stream::fail (const char* msg, int code) {
+	// Nur der erste Fehler ist aussagekräftig, die weiteren sind meist Folgefehler
+	if (m_error.empty ())
+		m_error = msg + std::string (libusb_error_name (code));
+	m_stopping = true;
+}
+
+/**
+ * Bricht die Läufe von "streams" ab und wertet die noch ausstehenden Transfers aus, bis keiner mehr aussteht, sodass die
+ * Streams und "completions" danach zerstört werden dürfen. Die Transfers aller Streams müssen über "completions" laufen.
+ * Liefert false, falls das nicht möglich ist, weil der Event-Thread des Geräts nicht mehr läuft; dann dürfen weder die
+ * Streams noch "completions" freigegeben werden, da libusb die ausstehenden Transfers weiter verwendet.
+ */
+bool drain (const std::vector<Stream*>& streams, CompletionQueue& completions) {
+	for (Stream* stream : streams)
+		stream->abort ();
+	try {
+		for (;;) {
+			bool active = false;
+			for (Stream* stream : streams)
+				active = stream->active () || active;
+			if (!active)
+				break;
+			libusb_transfer* transfer = completions.pop (std::chrono::milliseconds (100));
+			if (transfer)
+				Stream::dispatch (transfer);
+		}
+	} catch (const std::exception&) {
+		return false;
+	}
+	completions.waitForProducers ();
+	return true;
+}
+
+/**
+ * Bearbeitet einen Stream als Aufgabe in einem TaskPool. Die CompletionQueue des Streams plant die Aufgabe bei jedem
+ * abgeschlossenen Transfer ein, sofern sie nicht schon eingeplant ist oder läuft; m_scheduled stellt sicher, dass
+ * nie zwei Worker gleichzeitig denselben Stream bearbeiten. Die erste Ausführung startet den Stream. Die Aufgabe gibt
+ * den Pool erst frei, wenn keine Transfers mehr ausstehen; lässt sich das nach einem Fehler nicht sicherstellen, ist
+ * sie "abandoned" und darf nicht freigegeben werden.
+ *
+ * Sobald ein Worker m_scheduled zurückgesetzt hat, kann ein anderer die Aufgabe übernehmen und beenden, während der
+ * erste noch in run ist. m_runners zählt daher die Worker in run; der beendende Worker gibt den Pool, nach dem die
+ * Aufgabe freigegeben werden darf, erst frei, wenn er als einziger übrig ist.
+ */
+class StreamTask : public Task {
+	public:
+		StreamTask (ShardStream& entry, TaskPool& pool)
+			: m_entry (entry), m_pool (pool), m_completions (2 * entry.config.queueDepth + 1, notify, this),
+			  m_stream (*entry.device, entry.config, *entry.counters, m_completions), m_worker (entry.worker), m_started (false), m_scheduled (true),
+			  m_abandoned (false), m_runners (0) {
+
+			m_pool.hold ();
+			m_pool.submit (this, m_worker);
+		}
+		~StreamTask () {
+			// Der Event-Thread kann nach dem letzten push noch in notify auf m_scheduled und m_pool zugreifen
+			m_completions.waitForProducers ();
+		}
+
+		bool abandoned () const { return m_abandoned; }
+
+		void run (unsigned int worker) override {
+			m_runners.fetch_add (1, std::memory_order_relaxed);
+			// Weitere Transfers des Geräts landen bevorzugt bei diesem Worker, in dessen Cache die Daten jetzt liegen
+			m_worker.store (worker, std::memory_order_relaxed);
+			bool active;
+			try {
+				if (!m_started) {
+					m_stream.start ();
+					m_started = true;
+				}
+				for (libusb_transfer* transfer = m_completions.pop (std::chrono::milliseconds (0)); transfer; transfer = m_completions.pop (std::chrono::milliseconds (0)))
+					Stream::dispatch (transfer);
+				active = m_stream.active ();
+			} catch (const std::exception& e) {
+				m_entry.error = e.what ();
+				// Solange m_scheduled gesetzt ist, plant notify die Aufgabe nicht erneut ein, sodass hier gefahrlos
+				// bis zum Abschluss aller Transfers gewartet werden kann
+				m_abandoned = !drain ({ &m_stream }, m_completions);
+				complete ();
+				return;
+			}
+			if (!active) {
+				try {
+					m_entry.result = m_stream.finish ();
+				} catch (const std::exception& e) {
+					m_entry.error = e.what ();
+				}
+				complete ();
+				return;
+			}
+			// Ein Transfer, der nach dem Leeren der Queue, aber vor dem Zurücksetzen abgeschlossen wurde, hat die Aufgabe
+			// nicht eingeplant und wird hier gefunden
+			m_scheduled.store (false);
+			if (!m_completions.empty () && !m_scheduled.exchange (true))
+				m_pool.submit (this, worker);
+			// Danach darf nicht mehr auf die Aufgabe zugegriffen werden
+			m_runners.fetch_sub (1, std::memory_order_release);
+		}
+	private:
+		/// Wartet, bis alle übrigen Worker run verlassen haben, und meldet dann das Ende der Aufgabe
+		void complete () {
+			while (m_runners.load (std::memory_order_acquire) > 1)
+				std::this_thread::yield ();
+			m_pool.release ();
+		}
+
+		static void notify (void* arg) {
+			// Läuft im Event-Thread
+			StreamTask* task = static_cast<StreamTask*> (arg);
+			if (!task->m_scheduled.exchange (true))
+				task->m_pool.submit (task, task->m_worker.load (std::memory_order_relaxed));
+		}
+
+		ShardStream& m_entry;
+		TaskPool& m_pool;
+		CompletionQueue m_completions;
+		Stream m_stream;
+		/// Der Worker, der die Aufgabe zuletzt ausgeführt hat
+		std::atomic<unsigned int> m_worker;
+		bool m_started;
+		/// Ist gesetzt, solange die Aufgabe eingeplant ist oder läuft
+		std::atomic<bool> m_scheduled;
+		/// Ist gesetzt, wenn nach einem Fehler noch Transfers ausstehen könnten
+		bool m_abandoned;
+		/// Anzahl der Worker, die gerade run ausführen
+		std::atomic<unsigned int> m_runners;
+};
+
+}
+
+StreamResult streamHandling (Device& device, const StreamConfig& config, StreamCounters& counters) {
+	// Werden bei einem Abbruch ggf. absichtlich nicht freigegeben, siehe drain
+	std::unique_ptr<CompletionQueue> completions (new CompletionQueue (2 * config.queueDepth + 1));
+	std::unique_ptr<Stream> stream (new Stream (device, config, counters, *completions));
+	try {
+		stream->start ();
+		// Werte abgeschlossene Transfers aus, bis keine mehr ausstehen
+		while (stream->active ()) {
+			libusb_transfer* transfer = completions->pop (std::chrono::milliseconds (100));
+			if (transfer)
+				Stream::dispatch (transfer);
+		}
+	} catch (...) {
+		if (!drain ({ stream.get () }, *completions)) {
+			stream.release ();
+			completions.release ();
+		}
+		throw;
+	}
+	return stream->finish ();
+}
+
+void streamShard (std::vector<ShardStream>& shard) {
+	// Je Gerät so viele Plätze, wie Transfers gleichzeitig ausstehen können
+	size_t capacity = 1;
+	for (const ShardStream& entry : shard)
+		capacity += 2 * entry.config.queueDepth;
+	// Werden bei einem Abbruch ggf. absichtlich nicht freigegeben, siehe drain
+	std::unique_ptr<CompletionQueue> completions (new CompletionQueue (capacity));
+
+	// Ein Gerät, dessen Stream sich nicht anlegen lässt, fällt aus, ohne die übrigen aufzuhalten
+	std::vector<std::unique_ptr<Stream>> streams (shard.size ());
+	std::vector<Stream*> created;
+	try {
+		for (size_t i = 0; i < shard.size (); ++i) {
+			try {
+				streams [i].reset (new Stream (*shard [i].device, shard [i].config, *shard [i].counters, *completions));
+				created.push_back (streams [i].get ());
+				streams [i]->start ();
+			} catch (const std::exception& e) {
+				shard [i].error = e.what ();
+			}
+		}
+		for (;;) {
+			bool active = false;
+			for (Stream* stream : created)
+				active = stream->active () || active;
+			if (!active)
+				break;
+			libusb_transfer* transfer = completions->pop (std::chrono::milliseconds (100));
+			// Arbeite alle bereits abgeschlossenen Transfers ab, bevor wieder alle Geräte geprüft werden
+			while (transfer) {
+				Stream::dispatch (transfer);
+				transfer = completions->pop (std::chrono::milliseconds (0));
+			}
+		}
+	} catch (...) {
+		if (!drain (created, *completions)) {
+			for (std::unique_ptr<Stream>& stream : streams)
+				stream.release ();
+			completions.release ();
+		}
+		throw;
+	}
+	for (size_t i = 0; i < shard.size (); ++i) {
+		if (!streams [i])
+			continue;
+		try {
+			shard [i].result = streams [i]->finish ();
+		} catch (const std::exception& e) {
+			shard [i].error = e.what ();
+		}
+	}
+}
+
+void streamPooled (std::vector<ShardStream>& streams, TaskPool& pool) {
+	std::vector<std::unique_ptr<StreamTask>> tasks (streams.size ());
+	// Wartet, bis alle Aufgaben beendet sind; solche mit möglicherweise noch ausstehenden Transfers werden absichtlich
+	// nicht freigegeben, siehe drain
+	auto finish = [&] () {
+		pool.wait ();
+		for (std::unique_ptr<StreamTask>& task : tasks)
+			if (task && task->abandoned ())
+				task.release ();
+	};
+	try {
+		for (size_t i = 0; i < streams.size (); ++i)
+			tasks [i].reset (new StreamTask (streams [i], pool));
+	} catch (...) {
+		// Die bereits gestarteten Streams müssen zu Ende laufen, bevor ihre Transfers freigegeben werden
+		finish ();
+		throw;
+	}
+	finish ();
+}
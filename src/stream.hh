@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STREAM_HH_
+#define STREAM_HH_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "libusb.h"
+#include "usb.hh"
+#include "pattern.hh"
+#include "mismatch.hh"
+
+class Device;
+class TaskPool;
+struct StreamCounters;
+
+/// Größte zulässige Transfer-Größe in Bytes
+constexpr size_t maxTransferSize = 1024 * 1024;
+
+/// Art der Prüfung der Antworten im Streaming-Modus
+enum class VerifyMode {
+	/// Vergleiche jedes empfangene Byte mit dem neu erzeugten Muster; Fehler werden genau lokalisiert
+	Compare,
+	/**
+	 * Berechne beim Erzeugen jedes Blocks die CRC-32C der erwarteten Antwort und behalte nur diese 4 Bytes; die Antwort
+	 * wird nur noch über ihre CRC-32C geprüft. Fehlerhafte Blöcke werden erkannt, aber nicht die Position der Fehler.
+	 */
+	Digest
+};
+
+/// Parameter für den Streaming-Modus
+struct StreamConfig {
+	/// Anzahl gleichzeitig ausstehender Blöcke, d.h. OUT- und IN-Transfers je Richtung
+	unsigned int queueDepth = 8;
+	/// Laufzeit in Sekunden
+	double duration = 5;
+	/**
+	 * Größe eines Blocks in Bytes. Ist sie größer als die Paketgröße, wird der Transfer vom Kernel in mehrere Pakete aufgeteilt.
+	 * Bei 0 wird die Burst-Größe des Bulk-Endpoints genutzt.
+	 */
+	size_t transferSize = 0;
+	/// Beende OUT-Transfers, deren Länge ein Vielfaches der Paketgröße ist, mit einem Null-Paket und erwarte dieses auch in der Antwort
+	bool zlp = false;
+	/// Muster der gesendeten Daten
+	PatternType pattern = PatternType::Random;
+	/// Startwert des Musters; derselbe Seed ergibt dieselben Daten
+	uint64_t seed = 0;
+	/// Art der Prüfung der Antworten
+	VerifyMode verify = VerifyMode::Compare;
+};
+
+/// Ergebnis eines Laufs im Streaming-Modus
+struct StreamResult {
+	/// Anzahl vollständig gesendeter und zurück empfangener Blöcke
+	uint64_t blocks = 0;
+	/// Anzahl zurück empfangener Bytes
+	uint64_t bytes = 0;
+	/// Anzahl Blöcke, deren Antwort nicht korrekt umgedreht war
+	uint64_t mismatches = 0;
+	/// Die genauen Fehler aller Blöcke; bleibt bei VerifyMode::Digest leer
+	ErrorStats errors;
+	/// Gemessene Laufzeit in Sekunden
+	double seconds = 0;
+	/// Gibt an, ob die Transferpuffer direkt vom Kernel genutzt wurden (siehe BufferPool)
+	bool deviceMemory = false;
+};
+
+/**
+ * Berechnet die Länge, mit der ein IN-Transfer für die Antwort auf einen Block der Größe "transferSize" angefordert
+ * werden muss. Im ZLP-Modus beendet das Gerät Antworten, deren Länge ein Vielfaches der Paketgröße ist, mit einem
+ * Null-Paket. Damit dieses nicht als eigener (leerer) Transfer beim nächsten Block ankommt, wird dann ein weiteres
+ * Paket angefordert; der Transfer endet durch das Null-Paket trotzdem nach "transferSize" Bytes.
+ */
+inline size_t echoInLength (size_t transferSize, int maxPacketSize, bool zlp) {
+	return (zlp && maxPacketSize > 0 && transferSize % static_cast<size_t> (maxPacketSize) == 0) ? transferSize + static_cast<size_t> (maxPacketSize) : transferSize;
+}
+
+/**
+ * Sendet fortlaufend nach config.pattern erzeugte Blöcke der Größe config.transferSize an den Bulk-OUT-Endpoint und empfängt die Antworten vom Bulk-IN-Endpoint.
+ * Im Gegensatz zu dataHandling werden asynchrone Transfers genutzt, von denen in jeder Richtung bis zu
+ * config.queueDepth gleichzeitig ausstehen, sodass der Bus zwischen den Paketen nicht brach liegt.
+ * Die Callbacks der Transfers laufen im Event-Thread des Geräts (siehe Device::startEventHandling), die Prüfung der Antworten erfolgt im aufrufenden Thread. Die Zähler in "counters" werden während des Laufs fortlaufend
+ * aktualisiert und können von anderen Threads gelesen werden, z.B. von einem StatsReporter.
+ */
+StreamResult streamHandling (Device& device, const StreamConfig& config, StreamCounters& counters);
+
+/// Ein Gerät in einem Shard, den streamShard bearbeitet
+struct ShardStream {
+	Device* device = nullptr;
+	/// Parameter des Laufs auf diesem Gerät; transferSize darf nicht 0 sein
+	StreamConfig config;
+	/// Die fortlaufenden Zähler des Geräts
+	StreamCounters* counters = nullptr;
+	/// Ergebnis des Laufs, sofern er nicht abgebrochen wurde
+	StreamResult result;
+	/// Fehlermeldung, falls der Lauf abgebrochen wurde
+	std::string error;
+	/// Bei streamPooled der Worker, in dessen Warteschlange die Aufgaben des Geräts eingereiht werden
+	unsigned int worker = 0;
+};
+
+/**
+ * Führt den Streaming-Modus wie streamHandling auf allen Geräten von "shard" gleichzeitig im aufrufenden Thread aus.
+ * Die Transfers aller Geräte laufen über eine gemeinsame CompletionQueue, sodass der Thread Erzeugung und Prüfung
+ * für jedes Gerät übernimmt, dessen Antwort gerade vorliegt. Bricht der Lauf auf einem Gerät ab, wird dessen
+ * Fehler in "error" abgelegt und die übrigen laufen weiter.
+ */
+void streamShard (std::vector<ShardStream>& shard);
+
+/**
+ * Führt den Streaming-Modus wie streamShard auf allen Geräten von "streams" gleichzeitig aus, aber in den Workern
+ * von "pool". Sobald ein Transfer eines Geräts abgeschlossen ist, reiht der Callback im Event-Thread eine Aufgabe
+ * für das Gerät in die Warteschlange seines Workers ein, die Prüfung und Erzeugung übernimmt; diese wird also von
+ * einem freien Worker gestohlen, falls der eigene gerade mit anderen Geräten beschäftigt ist. Die Aufgaben eines
+ * Geräts laufen nie gleichzeitig, danach übernimmt der Worker, der die letzte ausgeführt hat, das Gerät. Kehrt erst
+ * zurück, wenn die Läufe auf allen Geräten beendet sind.
+ */
+void streamPooled (std::vector<ShardStream>& streams, TaskPool& pool);
+
+#endif /* STREAM_HH_ */
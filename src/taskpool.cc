@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "taskpool.hh"
+#include "affinity.hh"
+
+TaskPool::TaskPool (const std::vector<unsigned int>& cpus) : m_queued (0), m_sleeping (0), m_steals (0), m_stop (false), m_held (0) {
+	// Alle Warteschlangen müssen bestehen, bevor der erste Worker zu stehlen versucht
+	for (size_t i = 0; i < cpus.size (); ++i)
+		m_workers.emplace_back (new Worker);
+	for (size_t i = 0; i < cpus.size (); ++i)
+		m_workers [i]->thread = std::thread (&TaskPool::run, this, static_cast<unsigned int> (i), cpus [i]);
+}
+
+TaskPool::~TaskPool () {
+	{
+		std::lock_guard<std::mutex> lock (m_idleMutex);
+		m_stop = true;
+	}
+	m_idleCond.notify_all ();
+	for (const std::unique_ptr<Worker>& worker : m_workers)
+		worker->thread.join ();
+}
+
+void TaskPool::submit (Task* task, unsigned int worker) {
+	{
+		Worker& w = *m_workers [worker];
+		std::lock_guard<std::mutex> lock (w.mutex);
+		w.tasks.push_back (task);
+		m_queued.fetch_add (1);
+	}
+	// Stelle sicher, dass ein Worker entweder die neue Aufgabe sieht, oder hier als schlafend erkannt wird
+	if (m_sleeping.load () > 0) {
+		std::lock_guard<std::mutex> lock (m_idleMutex);
+		m_idleCond.notify_one ();
+	}
+}
+
+void TaskPool::hold () {
+	std::lock_guard<std::mutex> lock (m_heldMutex);
+	++m_held;
+}
+
+void TaskPool::release () {
+	std::lock_guard<std::mutex> lock (m_heldMutex);
+	if (--m_held == 0)
+		m_heldCond.notify_all ();
+}
+
+void TaskPool::wait () {
+	std::unique_lock<std::mutex> lock (m_heldMutex);
+	m_heldCond.wait (lock, [&] () { return m_held == 0; });
+}
+
+Task* TaskPool::take (unsigned int index) {
+	// Die eigene Warteschlange von hinten, da die zuletzt eingereihte Aufgabe am ehesten noch im Cache liegt
+	{
+		Worker& own = *m_workers [index];
+		std::lock_guard<std::mutex> lock (own.mutex);
+		if (!own.tasks.empty ()) {
+			Task* task = own.tasks.back ();
+			own.tasks.pop_back ();
+			m_queued.fetch_sub (1);
+			return task;
+		}
+	}
+	// Die anderen von vorne, da dort die Aufgaben am längsten warten; beginne beim Nachbarn, um die Last zu streuen
+	for (size_t i = 1; i < m_workers.size (); ++i) {
+		Worker& victim = *m_workers [(index + i) % m_workers.size ()];
+		std::lock_guard<std::mutex> lock (victim.mutex);
+		if (!victim.tasks.empty ()) {
+			Task* task = victim.tasks.front ();
+			victim.tasks.pop_front ();
+			m_queued.fetch_sub (1);
+			m_steals.fetch_add (1, std::memory_order_relaxed);
+			return task;
+		}
+	}
+	return nullptr;
+}
+
+void TaskPool::run (unsigned int index, unsigned int cpu) {
+	m_workers [index]->pinned = pinCurrentThread (cpu);
+	while (!m_stop) {
+		Task* task = take (index);
+		if (task) {
+			task->run (index);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock (m_idleMutex);
+		m_sleeping.fetch_add (1);
+		m_idleCond.wait (lock, [&] () { return m_stop || m_queued.load () > 0; });
+		m_sleeping.fetch_sub (1);
+	}
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TASKPOOL_HH_
+#define TASKPOOL_HH_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Eine Aufgabe für den TaskPool. Die Aufgaben werden nicht vom Pool verwaltet, sondern bestehen üblicherweise für
+ * die Dauer des ganzen Laufs und planen sich per TaskPool::submit selbst erneut ein, sodass beim Einreihen keine
+ * Heap-Allokationen nötig sind.
+ */
+class Task {
+	public:
+		/// Führt die Aufgabe im Worker Nummer "worker" aus
+		virtual void run (unsigned int worker) = 0;
+	protected:
+		~Task () = default;
+};
+
+/**
+ * Ein Pool von Worker-Threads mit je einer eigenen Warteschlange. Jeder Worker arbeitet zuerst die zuletzt in seine
+ * eigene Warteschlange eingereihte Aufgabe ab, deren Daten am ehesten noch im Cache liegen. Ist sie leer, stiehlt
+ * er die älteste Aufgabe eines anderen Workers, sodass ein Worker, dessen Aufgaben gerade langsam vorankommen,
+ * die übrigen nicht brach liegen lässt. Ohne Aufgaben schlafen die Worker. Die Warteschlangen sind per Mutex
+ * geschützt, da eine Aufgabe im Vergleich dazu lange läuft.
+ *
+ * Der Pool weiß nicht, wann alle Aufgaben erledigt sind, da sie sich selbst neu einplanen; dazu meldet der Aufrufer
+ * jede Aufgabe per hold an und sie sich bei ihrem Ende per release ab, worauf wait wartet.
+ */
+class TaskPool {
+	public:
+		/// Startet für jeden Eintrag von "cpus" einen Worker, der an diese CPU gebunden wird (siehe pinCurrentThread)
+		explicit TaskPool (const std::vector<unsigned int>& cpus);
+		/// Beendet alle Worker; noch eingereihte Aufgaben werden verworfen
+		~TaskPool ();
+
+		TaskPool (const TaskPool&) = delete;
+		TaskPool& operator = (const TaskPool&) = delete;
+
+		/// Anzahl der Worker
+		size_t workers () const { return m_workers.size (); }
+		/// Gibt an, ob Worker Nummer "worker" an seine CPU gebunden werden konnte; erst nach dem Start der Aufgaben gültig
+		bool pinned (unsigned int worker) const { return m_workers [worker]->pinned.load (); }
+		/// Anzahl der Aufgaben, die ein Worker aus der Warteschlange eines anderen genommen hat
+		uint64_t steals () const { return m_steals.load (std::memory_order_relaxed); }
+
+		/**
+		 * Reiht "task" in die Warteschlange von Worker Nummer "worker" ein und weckt ggf. einen schlafenden Worker.
+		 * Darf aus beliebigen Threads aufgerufen werden, z.B. aus einem Transfer-Callback im Event-Thread. Eine
+		 * Aufgabe darf erst erneut eingereiht werden, wenn sie begonnen hat.
+		 */
+		void submit (Task* task, unsigned int worker);
+
+		/// Meldet eine Aufgabe an, auf deren Ende wait wartet
+		void hold ();
+		/// Meldet das Ende einer per hold angemeldeten Aufgabe
+		void release ();
+		/// Wartet, bis alle per hold angemeldeten Aufgaben per release beendet wurden
+		void wait ();
+	private:
+		struct Worker {
+			std::mutex mutex;
+			std::deque<Task*> tasks;
+			std::atomic<bool> pinned { false };
+			std::thread thread;
+		};
+
+		void run (unsigned int index, unsigned int cpu);
+		Task* take (unsigned int index);
+
+		std::vector<std::unique_ptr<Worker>> m_workers;
+		/// Anzahl aller eingereihten Aufgaben; wird unter dem Mutex der jeweiligen Warteschlange geändert
+		std::atomic<size_t> m_queued;
+		/// Anzahl schlafender Worker
+		std::atomic<unsigned int> m_sleeping;
+		std::atomic<uint64_t> m_steals;
+		std::atomic<bool> m_stop;
+		std::mutex m_idleMutex;
+		std::condition_variable m_idleCond;
+
+		/// Anzahl per hold angemeldeter, noch nicht beendeter Aufgaben
+		size_t m_held;
+		std::mutex m_heldMutex;
+		std::condition_variable m_heldCond;
+};
+
+#endif /* TASKPOOL_HH_ */
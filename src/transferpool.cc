@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "transferpool.hh"
+
+TransferPool::TransferPool (libusb_device_handle* handle, unsigned char endpoint, size_t bufferSize, size_t count,
+							libusb_transfer_cb_fn callback, void* userData, unsigned int timeout, uint8_t flags)
+	: m_buffers (handle, bufferSize, count) {
+
+	m_transfers.reserve (count);
+	m_free.reserve (count);
+	for (size_t i = 0; i < count; ++i) {
+		TransferPtr transfer (libusb_alloc_transfer (0));
+		if (!transfer)
+			throw std::runtime_error ("Konnte Transfer nicht allozieren");
+
+		libusb_fill_bulk_transfer (transfer.get (), handle, endpoint, m_buffers.acquire (), static_cast<int> (bufferSize), callback, userData, timeout);
+		transfer->flags = flags;
+
+		m_free.push_back (transfer.get ());
+		m_transfers.push_back (std::move (transfer));
+	}
+}
+
+libusb_transfer* TransferPool::acquire () {
+	if (m_free.empty ())
+		return nullptr;
+	libusb_transfer* res = m_free.back ();
+	m_free.pop_back ();
+	return res;
+}
+
+void TransferPool::release (libusb_transfer* transfer) {
+	m_free.push_back (transfer);
+}
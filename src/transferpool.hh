@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TRANSFERPOOL_HH_
+#define TRANSFERPOOL_HH_
+
+#include <cstddef>
+#include <vector>
+#include "libusb.h"
+#include "usb.hh"
+#include "bufferpool.hh"
+
+/**
+ * Alloziert im Konstruktor eine feste Anzahl von Bulk-Transfers für einen Endpoint, jeweils mit eigenem Puffer
+ * aus einem BufferPool, und vergibt diese anschließend immer wieder. Nach dem Konstruktor finden weder in acquire
+ * noch in release Heap-Allokationen statt, sodass ein damit arbeitender Streaming-Pfad im eingeschwungenen Zustand
+ * ohne Allokationen auskommt. Alle Transfers werden im Destruktor freigegeben und dürfen dann nicht mehr ausstehen.
+ */
+class TransferPool {
+	public:
+		/**
+		 * Alloziert "count" Transfers für "endpoint" mit Puffern der Größe "bufferSize". "callback" und
+		 * "userData" werden in jeden Transfer eingetragen, ebenso "flags" (LIBUSB_TRANSFER_*).
+		 */
+		TransferPool (libusb_device_handle* handle, unsigned char endpoint, size_t bufferSize, size_t count,
+						libusb_transfer_cb_fn callback, void* userData, unsigned int timeout, uint8_t flags = 0);
+
+		TransferPool (const TransferPool&) = delete;
+		TransferPool& operator = (const TransferPool&) = delete;
+
+		/// Entnimmt einen freien Transfer. Sind alle vergeben, wird nullptr geliefert.
+		libusb_transfer* acquire ();
+		/// Gibt einen per acquire entnommenen und nicht mehr ausstehenden Transfer zurück
+		void release (libusb_transfer* transfer);
+
+		/// Anzahl gerade nicht vergebener Transfers
+		size_t available () const { return m_free.size (); }
+		/// Gibt an, ob die Puffer im Kernel gemappt sind (siehe BufferPool)
+		bool deviceMemory () const { return m_buffers.deviceMemory (); }
+	private:
+		BufferPool m_buffers;
+		/// Alle Transfers; werden über den Deleter in TransferPtr freigegeben
+		std::vector<TransferPtr> m_transfers;
+		/// Die gerade nicht vergebenen Transfers
+		std::vector<libusb_transfer*> m_free;
+};
+
+#endif /* TRANSFERPOOL_HH_ */
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include "usb.hh"
+
+namespace {
+
+/// Prüft Bus- und Port-Nummern; libusb hält diese vor, es findet also kein Zugriff auf das Gerät statt
+bool matchesPath (libusb_device* device, const DeviceSelector& selector) {
+	if (selector.bus != 0 && libusb_get_bus_number (device) != selector.bus)
+		return false;
+	if (selector.ports.empty ())
+		return true;
+	uint8_t ports [maxPortDepth];
+	int count = libusb_get_port_numbers (device, ports, sizeof (ports));
+	return count == static_cast<int> (selector.ports.size ()) && std::equal (selector.ports.begin (), selector.ports.end (), ports);
+}
+
+/// Prüft VID und PID aus dem Geräte-Deskriptor
+bool matchesDescriptor (const libusb_device_descriptor& desc, const DeviceSelector& selector) {
+	return desc.idVendor == selector.vendorId && desc.idProduct == selector.productId;
+}
+
+/// Prüft die Seriennummer; dazu muss das Gerät kurz geöffnet werden
+bool matchesSerial (libusb_device* device, const libusb_device_descriptor& desc, const DeviceSelector& selector) {
+	if (selector.serial.empty ())
+		return true;
+	if (desc.iSerialNumber == 0)
+		return false;
+	libusb_device_handle* handle_raw;
+	if (libusb_open (device, &handle_raw) != 0)
+		return false;
+	DevPtr handle (handle_raw);
+	unsigned char serial [256];
+	int length = libusb_get_string_descriptor_ascii (handle.get (), desc.iSerialNumber, serial, sizeof (serial));
+	return length >= 0 && selector.serial == std::string (reinterpret_cast<const char*> (serial), static_cast<size_t> (length));
+}
+
+}
+
+
+EndpointTable readEndpoints (libusb_context* ctx, libusb_device* device) {
+	// Frage Konfigurations-Deskriptor ab, libusb_get_active_config_descriptor allokiert Speicher
+	libusb_config_descriptor* config_raw;
+	lu_err (libusb_get_active_config_descriptor (device, &config_raw), "Konnte Konfigurations-Deskriptor nicht abfragen: ");
+	// Verpacke Deskriptor in unique_ptr für automatische Freigabe
+	ConfigPtr config (config_raw);
+
+	EndpointTable table {};
+	// Iteriere alle Interfaces, jeweils in der Standard-Alternate-Setting
+	for (uint8_t iIf = 0; iIf < config->bNumInterfaces; ++iIf) {
+		const libusb_interface& interface = config->interface [iIf];
+		if (interface.num_altsetting < 1)
+			continue;
+		const libusb_interface_descriptor& ifDesc = interface.altsetting [0];
+
+		for (uint8_t iEp = 0; iEp < ifDesc.bNumEndpoints; ++iEp) {
+			const libusb_endpoint_descriptor& epDesc = ifDesc.endpoint [iEp];
+
+			EndpointInfo ep;
+			ep.address = epDesc.bEndpointAddress;
+			ep.type = epDesc.bmAttributes & 3;
+			ep.interface = ifDesc.bInterfaceNumber;
+			// Bits 11-12 enthalten bei High-Speed Isochronous/Interrupt die Anzahl zusätzlicher Transaktionen, nicht die Größe
+			ep.maxPacketSize = epDesc.wMaxPacketSize & 0x7FF;
+			ep.burst = 1;
+
+			// Bei SuperSpeed gibt der Companion-Deskriptor an, wie viele Pakete am Stück übertragen werden
+			libusb_ss_endpoint_companion_descriptor* companion;
+			if (libusb_get_ss_endpoint_companion_descriptor (ctx, &epDesc, &companion) == LIBUSB_SUCCESS) {
+				ep.burst = static_cast<uint8_t> (companion->bMaxBurst + 1);
+				libusb_free_ss_endpoint_companion_descriptor (companion);
+			}
+			table.endpoints.push_back (ep);
+		}
+	}
+
+	// Suche den ersten Bulk-OUT-Endpoint, und einen Bulk-IN-Endpoint auf demselben Interface
+	bool found = false;
+	for (const EndpointInfo& out : table.endpoints) {
+		if (out.type != LIBUSB_TRANSFER_TYPE_BULK || (out.address & LIBUSB_ENDPOINT_IN))
+			continue;
+		for (const EndpointInfo& in : table.endpoints) {
+			if (in.type == LIBUSB_TRANSFER_TYPE_BULK && (in.address & LIBUSB_ENDPOINT_IN) && in.interface == out.interface) {
+				table.bulkOut = out;
+				table.bulkIn = in;
+				found = true;
+				break;
+			}
+		}
+		if (found)
+			break;
+	}
+	if (!found)
+		throw std::runtime_error ("Gerät hat kein Paar aus Bulk-Endpoints.");
+
+	return table;
+}
+
+void parseDevicePath (const std::string& path, DeviceSelector& selector) {
+	// Alle Nummern sind 1 bis 255; der Bus steht vor dem "-", die Ports sind durch "." getrennt
+	auto parsePart = [&] (const std::string& part) {
+		size_t pos = 0;
+		unsigned long value = 0;
+		try {
+			value = std::stoul (part, &pos, 10);
+		} catch (const std::exception&) {
+			pos = 0;
+		}
+		if (part.empty () || pos != part.size () || value == 0 || value > 255)
+			throw std::runtime_error ("Ungültiger Geräte-Pfad: " + path);
+		return static_cast<uint8_t> (value);
+	};
+	size_t dash = path.find ('-');
+	selector.bus = parsePart (path.substr (0, dash));
+	selector.ports.clear ();
+	if (dash == std::string::npos)
+		return;
+	std::istringstream ports (path.substr (dash + 1));
+	std::string port;
+	while (std::getline (ports, port, '.'))
+		selector.ports.push_back (parsePart (port));
+	if (selector.ports.empty () || selector.ports.size () > maxPortDepth || path.back () == '.')
+		throw std::runtime_error ("Ungültiger Geräte-Pfad: " + path);
+}
+
+bool deviceMatches (libusb_device* device, const DeviceSelector& selector) {
+	if (!matchesPath (device, selector))
+		return false;
+	libusb_device_descriptor desc;
+	if (libusb_get_device_descriptor (device, &desc) != 0)
+		return false;
+	return matchesDescriptor (desc, selector) && matchesSerial (device, desc, selector);
+}
+
+std::vector<DevRefPtr> findDevices (libusb_context* ctx, std::ostream& out, const DeviceSelector& selector) {
+	// Die Liste der angeschlossenen Geräte
+	libusb_device **list_raw;
+	// Frage Liste ab, libusb_get_device_list allokiert Speicher
+	ssize_t cnt = lu_err(libusb_get_device_list (ctx, &list_raw), "Liste angeschlossener Geräte konnte nicht abgefragt werden: ");
+	
+	// Verpacke Liste in unique_ptr für automatische Freigabe
+	DevListPtr list (list_raw);
+
+	// Iteriere gefundene Geräte
+	std::vector<DevRefPtr> found;
+	out << "Angeschlossene Geräte:\n";
+	for (ssize_t i = 0; i < cnt; i++) {
+		// Das Gerät
+		libusb_device *device = list [i];
+		// Geräte an einem anderen Pfad werden übersprungen, ohne auf sie zuzugreifen
+		if (!matchesPath (device, selector))
+			continue;
+		libusb_device_descriptor deviceDescriptor;
+		// Frage Device Descriptor ab
+		lu_err (libusb_get_device_descriptor (device, &deviceDescriptor), "Konnte Geräte-Deskriptor nicht abfragen: ");
+
+		// Gebe Adresse und VID/PID des Geräts aus
+		out			<< std::dec << int { libusb_get_bus_number(device) } << ":" << int { libusb_get_port_number(device) } << ":" << int { libusb_get_device_address (device) } << " "
+					<< std::hex << std::setw(4) << std::setfill('0') << deviceDescriptor.idVendor << ":"
+					<< std::hex << std::setw(4) << std::setfill('0') << deviceDescriptor.idProduct << std::endl;
+
+		// Prüfe auf gewünschte VID+PID und erst dann ggf. die Seriennummer; behalte eine eigene Referenz, da die Liste danach freigegeben wird
+		if (matchesDescriptor (deviceDescriptor, selector) && matchesSerial (device, deviceDescriptor, selector))
+			found.emplace_back (libusb_ref_device (device));
+	}
+	return found;
+}
+
+DevPtr openDevice (libusb_context* ctx, libusb_device_descriptor& desc, EndpointTable& endpoints, std::ostream& out, const DeviceSelector& selector) {
+	std::vector<DevRefPtr> found = findDevices (ctx, out, selector);
+	if (found.empty ())
+		throw std::runtime_error ("Kein passendes USB-Gerät gefunden.");
+
+	// Merke Device-Descriptor des ersten passenden Geräts
+	lu_err (libusb_get_device_descriptor (found.front ().get (), &desc), "Konnte Geräte-Deskriptor nicht abfragen: ");
+	return openDevice (ctx, found.front ().get (), endpoints);
+}
+
+DevPtr openDevice (libusb_context* ctx, libusb_device* device, EndpointTable& endpoints) {
+	// Öffne Device
+	libusb_device_handle *handle = nullptr;
+	lu_err (libusb_open (device, &handle), "Konnte Gerät nicht öffnen: ");
+	
+	// Verpacke Handle in unique_ptr für automatische Freigabe
+	DevPtr devPtr (handle);
+
+	// Lese die Endpoints einmalig aus, damit Puffer- und Paketgrößen nicht fest vorgegeben sein müssen
+	endpoints = readEndpoints (ctx, device);
+
+	// Beanspruche das Interface der Bulk-Endpoints für diese Anwendung (sendet nichts auf dem Bus)
+	lu_err (libusb_claim_interface (handle, endpoints.bulkOut.interface), "Konnte Interface nicht öffnen: ");
+
+	return devPtr;
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef USB_HH_
+#define USB_HH_
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "libusb.h"
+
+/**
+ * Wird dieser Funktion ein libusb-Error Code übergeben, löst sie eine Exception mit der
+ * gegebenen Fehlermeldung und den dem Code entsprechenden Informationen der LibUsb aus
+ */
+template <typename Ret>
+Ret lu_err (Ret r, std::string errmsg) {
+	if (r < 0)
+		// Frage Fehlerbeschreibung der Libusb ab und baue Fehlermeldung zusammen
+		throw std::runtime_error (errmsg + libusb_error_name (static_cast<int> (r)) + " - " + libusb_strerror (static_cast<libusb_error> (r)));
+	return r;
+}
+
+/// Ein Dummy-Struct zur Freigabe des libusb context. Kann als "Deleter" in std::unique_ptr genutzt werden.
+struct ExitLibusb {
+	void operator () (libusb_context* ctx) {
+		libusb_exit (ctx);
+	}
+};
+/// Ein libusb_context welcher in diesem unique_ptr verpackt wird, wird automatisch korrekt freigegeben.
+using CtxPtr = std::unique_ptr<libusb_context, ExitLibusb>;
+
+/// Ein Dummy-Struct zur Freigabe von libusb_device* Listen. Kann als "Deleter" in std::unique_ptr genutzt werden.
+struct FreeDeviceList {
+	void operator () (libusb_device ** list) {
+		libusb_free_device_list (list, 1);
+	}
+};
+/// Eine Liste aus libusb_device* welche in diesem unique_ptr verpackt wird, wird automatisch korrekt freigegeben.
+using DevListPtr = std::unique_ptr<libusb_device* [], FreeDeviceList>;
+
+/// Ein Dummy-Struct zur Freigabe einer Referenz auf ein libusb_device. Kann als "Deleter" in std::unique_ptr genutzt werden.
+struct UnrefDevice {
+	void operator () (libusb_device* dev) {
+		libusb_unref_device (dev);
+	}
+};
+/// Ein libusb_device, dessen per libusb_ref_device erhaltene Referenz in diesem unique_ptr verpackt wird, wird automatisch freigegeben.
+using DevRefPtr = std::unique_ptr<libusb_device, UnrefDevice>;
+
+/// Ein Dummy-Struct zur Freigabe von libusb_device_handle. Kann als "Deleter" in std::unique_ptr genutzt werden.
+struct CloseDevice {
+	void operator () (libusb_device_handle* dev) {
+		libusb_close (dev);
+	}
+};
+/// Ein libusb_device_handle welcher in diesem unique_ptr verpackt wird, wird automatisch korrekt freigegeben.
+using DevPtr = std::unique_ptr<libusb_device_handle, CloseDevice>;
+
+/// Ein Dummy-Struct zur Freigabe von libusb_transfer. Kann als "Deleter" in std::unique_ptr genutzt werden.
+struct FreeTransfer {
+	void operator () (libusb_transfer* transfer) {
+		libusb_free_transfer (transfer);
+	}
+};
+/// Ein libusb_transfer welcher in diesem unique_ptr verpackt wird, wird automatisch korrekt freigegeben.
+using TransferPtr = std::unique_ptr<libusb_transfer, FreeTransfer>;
+
+/// Ein Dummy-Struct zur Freigabe von Konfigurations-Deskriptoren. Kann als "Deleter" in std::unique_ptr genutzt werden.
+struct FreeConfigDescriptor {
+	void operator () (libusb_config_descriptor* config) {
+		libusb_free_config_descriptor (config);
+	}
+};
+/// Ein libusb_config_descriptor welcher in diesem unique_ptr verpackt wird, wird automatisch korrekt freigegeben.
+using ConfigPtr = std::unique_ptr<libusb_config_descriptor, FreeConfigDescriptor>;
+
+/// Die für die Übertragungen relevanten Daten eines Endpoints aus dem Konfigurations-Deskriptor
+struct EndpointInfo {
+	/// bEndpointAddress, inklusive Richtungs-Bit
+	uint8_t address;
+	/// Übertragungsart, d.h. die unteren beiden Bits von bmAttributes (LIBUSB_TRANSFER_TYPE_*)
+	uint8_t type;
+	/// Nummer des Interfaces, zu dem der Endpoint gehört
+	uint8_t interface;
+	/// Anzahl der Pakete pro Burst (bMaxBurst+1) bei SuperSpeed, sonst 1
+	uint8_t burst;
+	/// Paketgröße aus wMaxPacketSize
+	uint16_t maxPacketSize;
+
+	/// Anzahl Bytes, die der Endpoint am Stück (in einem Burst) überträgt
+	size_t burstSize () const { return size_t { maxPacketSize } * burst; }
+};
+
+/**
+ * Die einmalig beim Öffnen aus der aktiven Konfiguration gelesenen Endpoints eines Geräts. Neben der
+ * vollständigen Liste werden die beiden für die Echo-Funktion genutzten Bulk-Endpoints direkt abgelegt,
+ * sodass die Übertragungsfunktionen die Deskriptoren nicht erneut abfragen müssen.
+ */
+struct EndpointTable {
+	/// Alle Endpoints der aktiven Konfiguration (ohne Endpoint 0), jeweils aus der ersten Alternate Setting
+	std::vector<EndpointInfo> endpoints;
+	/// Der erste Bulk-OUT-Endpoint
+	EndpointInfo bulkOut;
+	/// Der erste Bulk-IN-Endpoint auf demselben Interface wie bulkOut
+	EndpointInfo bulkIn;
+};
+
+/**
+ * Liest die Endpoints der aktiven Konfiguration des Geräts aus und sucht das für die Echo-Funktion
+ * genutzte Paar aus Bulk-Endpoints. Hat das Gerät kein solches Paar, wird eine Exception ausgelöst.
+ */
+EndpointTable readEndpoints (libusb_context* ctx, libusb_device* device);
+
+/// Größte Anzahl Port-Nummern vom Root-Hub bis zum Gerät; USB erlaubt höchstens 7 Ebenen
+constexpr size_t maxPortDepth = 7;
+
+/**
+ * Die Kriterien, nach denen findDevices die Geräte auswählt. Standardmäßig passen alle f1usb-Geräte (VID:PID DEAD:BEEF).
+ */
+struct DeviceSelector {
+	/// Gesuchte VID und PID
+	uint16_t vendorId = 0xDEAD, productId = 0xBEEF;
+	/// Nummer des Busses; 0 für beliebig
+	uint8_t bus = 0;
+	/// Die Port-Nummern vom Root-Hub bis zum Gerät; leer für beliebig, sonst muss auch "bus" angegeben sein
+	std::vector<uint8_t> ports;
+	/// Gesuchte Seriennummer; leer für beliebig. Zum Vergleich muss das Gerät geöffnet werden.
+	std::string serial;
+};
+
+/**
+ * Wandelt einen Geräte-Pfad im Format von sysfs, z.B. "2-1.4" für Port 4 des Hubs an Port 1 von Bus 2, in Bus- und
+ * Port-Nummern von "selector" um. Ein ungültiger Pfad löst eine Exception aus.
+ */
+void parseDevicePath (const std::string& path, DeviceSelector& selector);
+
+/**
+ * Prüft, ob "device" zu "selector" passt. Die Kriterien werden nach ihrem Aufwand geprüft und die Prüfung beim ersten
+ * nicht passenden beendet: Bus- und Port-Nummern hält libusb bereits vor, der Geräte-Deskriptor liegt unter Linux
+ * im Speicher bzw. sysfs, nur für die Seriennummer muss das Gerät geöffnet und ein String-Deskriptor per Control-Transfer
+ * abgefragt werden. Lässt sich das Gerät dazu nicht öffnen, passt es nicht.
+ */
+bool deviceMatches (libusb_device* device, const DeviceSelector& selector);
+
+/**
+ * Fragt die Liste der im gegebenen libusb-Kontext angeschlossenen Geräte ab und liefert alle zu "selector" passenden in
+ * der Reihenfolge der Liste. Die Geräte werden dabei auf "out" ausgegeben; ist ein Pfad angegeben, nur die an
+ * diesem Pfad, damit für die übrigen nicht einmal der Geräte-Deskriptor gelesen wird.
+ */
+std::vector<DevRefPtr> findDevices (libusb_context* ctx, std::ostream& out, const DeviceSelector& selector = DeviceSelector {});
+
+/**
+ * Sucht im gegebenen libusb-Kontext das erste zu "selector" passende USB-Gerät, öffnet es und gibt das entsprechende libusb-Handle zurück.
+ * Außerdem wird der USB-Deskriptor in den Parameter "desc" und die Endpoints der aktiven Konfiguration in "endpoints"
+ * geschrieben. Die Liste der angeschlossenen Geräte wird auf "out" ausgegeben. Falls kein Gerät gefunden wurde, wird eine
+ * Exception ausgelöst.
+ */
+DevPtr openDevice (libusb_context* ctx, libusb_device_descriptor& desc, EndpointTable& endpoints, std::ostream& out, const DeviceSelector& selector = DeviceSelector {});
+
+/**
+ * Öffnet das gegebene Gerät, liest die Endpoints der aktiven Konfiguration nach "endpoints" und beansprucht das
+ * Interface der Bulk-Endpoints. Bei einem Fehler wird eine Exception ausgelöst.
+ */
+DevPtr openDevice (libusb_context* ctx, libusb_device* device, EndpointTable& endpoints);
+
+#endif /* USB_HH_ */
@@ -0,0 +1,433 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Stellt das f1usb-Gerät per raw_gadget als Linux-USB-Gadget bereit, z.B. auf dem virtuellen Controller dummy_hcd,
+ * sodass usbclient ohne Hardware über den echten Kernel-Pfad (libusb, usbfs, USB-Core) getestet und gemessen werden kann.
+ * Das Gadget meldet sich wie die Firmware mit VID:PID DEAD:BEEF, beantwortet die LED-Requests und schickt jedes an den
+ * Bulk-OUT-Endpoint gesendete Paket mit umgedrehten Bits am Bulk-IN-Endpoint zurück. Wird nach "--" ein Befehl angegeben,
+ * wird dieser ausgeführt, sobald der Host das Gadget konfiguriert hat; das Programm endet dann mit dessen Exit-Code.
+ * Benötigt root-Rechte und die Module dummy_hcd und raw_gadget.
+ * Aufruf: usbgadget [--driver NAME] [--device NAME] [--speed full|high] [-- BEFEHL ...]
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <endian.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <linux/usb/ch9.h>
+#include <linux/usb/raw_gadget.h>
+#include "kernels.hh"
+
+namespace {
+
+/// Die String-Deskriptoren 1 bis 3 (Hersteller, Produkt, Seriennummer), wie bei der Firmware
+const char* const gadgetStrings [] = { "ACME Corp.", "Fluxkompensator", "42-1337-47/11" };
+
+/// Größte Datenmenge einer Control-Übertragung bzw. eines Bulk-Pakets
+constexpr size_t maxData = 1024;
+
+/// Wartezeit nach der Konfiguration, bis der Host das Gerät im usbfs angelegt hat und der Befehl gestartet wird
+constexpr std::chrono::milliseconds startDelay (1000);
+
+/// Über die Kommandozeile einstellbare Optionen
+struct GadgetOptions {
+	/// Name des Treibers und des Geräts des USB-Device-Controllers, unter /sys/class/udc zu finden
+	std::string driver = "dummy_udc", device = "dummy_udc.0";
+	/// Geschwindigkeit, mit der sich das Gadget meldet
+	usb_device_speed speed = USB_SPEED_HIGH;
+	/// Nach der Konfiguration auszuführender Befehl; leer, um nur das Gadget bereitzustellen
+	std::vector<std::string> command;
+};
+
+/**
+ * Puffer für die ioctl-Aufrufe mit usb_raw_event bzw. usb_raw_ep_io, deren Daten direkt auf die Struktur folgen.
+ * Da diese mit einem Array ohne Größe endet, kann sie nicht einfach Element einer anderen Struktur sein.
+ */
+template <typename Header>
+class IoBuffer {
+	public:
+		Header* header () { return reinterpret_cast<Header*> (m_raw); }
+		unsigned char* data () { return m_raw + sizeof (Header); }
+	private:
+		alignas (Header) unsigned char m_raw [sizeof (Header) + maxData];
+};
+
+/// Führt einen ioctl-Aufruf aus und löst bei einem Fehler eine Exception mit der Fehlermeldung "msg" aus
+int rawIoctl (int fd, unsigned long request, void* arg, const char* msg) {
+	int res = ioctl (fd, request, arg);
+	if (res < 0)
+		throw std::runtime_error (msg + std::string (std::strerror (errno)));
+	return res;
+}
+
+/// Hängt einen 16-Bit-Wert im Little-Endian-Format an
+void appendLe16 (std::vector<unsigned char>& data, uint16_t value) {
+	data.push_back (static_cast<unsigned char> (value & 0xFF));
+	data.push_back (static_cast<unsigned char> (value >> 8));
+}
+
+/// Ein per EPS_INFO gefundener Endpoint des Controllers
+struct GadgetEndpoint {
+	/// bEndpointAddress, inklusive Richtungs-Bit
+	uint8_t address = 0;
+	/// Paketgröße
+	uint16_t maxPacketSize = 0;
+	/// Von USB_RAW_IOCTL_EP_ENABLE gelieferte Nummer für EP_READ/EP_WRITE
+	uint16_t handle = 0;
+};
+
+class Gadget {
+	public:
+		explicit Gadget (const GadgetOptions& opts);
+		~Gadget ();
+
+		Gadget (const Gadget&) = delete;
+		Gadget& operator = (const Gadget&) = delete;
+
+		/// Bearbeitet die Control-Requests des Hosts, bis das Programm beendet wird
+		void run ();
+	private:
+		void findEndpoints ();
+		void handleControl (const usb_ctrlrequest& setup);
+		void handleDescriptor (const usb_ctrlrequest& setup);
+		void configure ();
+		void echo ();
+		void startCommand ();
+
+		/// Sendet die Antwort auf einen Control-Request, höchstens so viele Bytes wie angefordert
+		void ep0Write (const usb_ctrlrequest& setup, const unsigned char* data, size_t length);
+		/// Bestätigt einen Control-Request ohne Daten
+		void ep0Ack ();
+		/// Weist einen Control-Request mit STALL ab
+		void ep0Stall ();
+
+		const GadgetOptions& m_opts;
+		int m_fd;
+		GadgetEndpoint m_out, m_in;
+		/// Der per Vendor-Request 1 gesetzte LED-Zustand
+		uint8_t m_leds;
+		bool m_configured;
+		std::thread m_echoThread, m_commandThread;
+};
+
+Gadget::Gadget (const GadgetOptions& opts) : m_opts (opts), m_fd (-1), m_leds (0), m_configured (false) {
+	m_fd = open ("/dev/raw-gadget", O_RDWR);
+	if (m_fd < 0)
+		throw std::runtime_error ("Konnte /dev/raw-gadget nicht öffnen (Modul raw_gadget geladen?): " + std::string (std::strerror (errno)));
+
+	usb_raw_init init {};
+	std::strncpy (reinterpret_cast<char*> (init.driver_name), opts.driver.c_str (), UDC_NAME_LENGTH_MAX - 1);
+	std::strncpy (reinterpret_cast<char*> (init.device_name), opts.device.c_str (), UDC_NAME_LENGTH_MAX - 1);
+	init.speed = static_cast<__u8> (opts.speed);
+	try {
+		rawIoctl (m_fd, USB_RAW_IOCTL_INIT, &init, "Initialisierung von raw_gadget fehlgeschlagen: ");
+		rawIoctl (m_fd, USB_RAW_IOCTL_RUN, nullptr, "Start von raw_gadget fehlgeschlagen: ");
+	} catch (...) {
+		close (m_fd);
+		throw;
+	}
+}
+
+Gadget::~Gadget () {
+	// Die Threads blockieren in ioctl-Aufrufen und enden erst mit dem Prozess
+	if (m_echoThread.joinable ())
+		m_echoThread.detach ();
+	if (m_commandThread.joinable ())
+		m_commandThread.detach ();
+	close (m_fd);
+}
+
+void Gadget::run () {
+	IoBuffer<usb_raw_event> event;
+	while (true) {
+		event.header ()->type = 0;
+		event.header ()->length = maxData;
+		rawIoctl (m_fd, USB_RAW_IOCTL_EVENT_FETCH, event.header (), "Konnte Event nicht abfragen: ");
+		switch (event.header ()->type) {
+			case USB_RAW_EVENT_CONNECT:
+				findEndpoints ();
+				break;
+			case USB_RAW_EVENT_CONTROL: {
+				usb_ctrlrequest setup;
+				std::memcpy (&setup, event.data (), sizeof (setup));
+				handleControl (setup);
+				break;
+			}
+			default:
+				break;
+		}
+	}
+}
+
+void Gadget::findEndpoints () {
+	usb_raw_eps_info info {};
+	const int count = rawIoctl (m_fd, USB_RAW_IOCTL_EPS_INFO, &info, "Konnte Endpoints nicht abfragen: ");
+	// Nutze den ersten Bulk-Endpoint jeder Richtung; Endpoints ohne feste Adresse bekommen die nächste freie Nummer
+	uint8_t nextNumber = 1;
+	for (int i = 0; i < count; ++i) {
+		const usb_raw_ep_info& ep = info.eps [i];
+		if (ep.addr != USB_RAW_EP_ADDR_ANY)
+			nextNumber = std::max (nextNumber, static_cast<uint8_t> (ep.addr + 1));
+	}
+	const uint16_t packetSize = m_opts.speed == USB_SPEED_HIGH ? 512 : 64;
+	for (int i = 0; i < count; ++i) {
+		const usb_raw_ep_info& ep = info.eps [i];
+		if (!ep.caps.type_bulk)
+			continue;
+		GadgetEndpoint* target = nullptr;
+		if (ep.caps.dir_out && m_out.address == 0)
+			target = &m_out;
+		else if (ep.caps.dir_in && m_in.address == 0)
+			target = &m_in;
+		if (!target)
+			continue;
+		const uint8_t number = ep.addr == USB_RAW_EP_ADDR_ANY ? nextNumber++ : static_cast<uint8_t> (ep.addr);
+		target->address = static_cast<uint8_t> (number | (target == &m_in ? USB_DIR_IN : USB_DIR_OUT));
+		target->maxPacketSize = std::min (packetSize, ep.limits.maxpacket_limit);
+	}
+	if (m_out.address == 0 || m_in.address == 0)
+		throw std::runtime_error ("Der Controller hat kein Paar aus Bulk-Endpoints");
+}
+
+void Gadget::handleControl (const usb_ctrlrequest& setup) {
+	const uint16_t value = le16toh (setup.wValue);
+	if (setup.bRequestType == USB_DIR_IN && setup.bRequest == USB_REQ_GET_DESCRIPTOR)
+		handleDescriptor (setup);
+	else if (setup.bRequestType == USB_DIR_OUT && setup.bRequest == USB_REQ_SET_CONFIGURATION && value == 1) {
+		configure ();
+		ep0Ack ();
+	} else if (setup.bRequestType == USB_RECIP_INTERFACE && setup.bRequest == USB_REQ_SET_INTERFACE && value == 0)
+		ep0Ack ();
+	// Vendor-Request 2: Frage LED-Zustand ab
+	else if (setup.bRequestType == (USB_DIR_IN | USB_TYPE_VENDOR) && setup.bRequest == 2)
+		ep0Write (setup, &m_leds, 1);
+	// Vendor-Request 1: Setze LED-Zustand aus wValue
+	else if (setup.bRequestType == (USB_DIR_OUT | USB_TYPE_VENDOR) && setup.bRequest == 1) {
+		m_leds = static_cast<uint8_t> (value & 3);
+		ep0Ack ();
+	} else
+		ep0Stall ();
+}
+
+void Gadget::handleDescriptor (const usb_ctrlrequest& setup) {
+	const uint8_t type = static_cast<uint8_t> (le16toh (setup.wValue) >> 8), index = static_cast<uint8_t> (le16toh (setup.wValue));
+	std::vector<unsigned char> desc;
+	switch (type) {
+		case USB_DT_DEVICE:
+		case USB_DT_DEVICE_QUALIFIER:
+			// Der Qualifier enthält dieselben Angaben ohne VID, PID, Version und Strings
+			desc = { 0, type };
+			appendLe16 (desc, 0x0200);
+			desc.insert (desc.end (), { USB_CLASS_PER_INTERFACE, 0, 0, 64 });
+			if (type == USB_DT_DEVICE) {
+				appendLe16 (desc, 0xDEAD);
+				appendLe16 (desc, 0xBEEF);
+				appendLe16 (desc, 0x0100);
+				desc.insert (desc.end (), { 1, 2, 3 });
+			}
+			desc.push_back (1);
+			if (type == USB_DT_DEVICE_QUALIFIER)
+				desc.push_back (0);
+			break;
+		case USB_DT_CONFIG: {
+			desc = { USB_DT_CONFIG_SIZE, USB_DT_CONFIG, 0, 0, 1, 1, 0, USB_CONFIG_ATT_ONE, 50 };
+			desc.insert (desc.end (), { USB_DT_INTERFACE_SIZE, USB_DT_INTERFACE, 0, 0, 2, USB_CLASS_VENDOR_SPEC, 0, 0, 0 });
+			for (const GadgetEndpoint* ep : { &m_out, &m_in }) {
+				desc.insert (desc.end (), { USB_DT_ENDPOINT_SIZE, USB_DT_ENDPOINT, ep->address, USB_ENDPOINT_XFER_BULK });
+				appendLe16 (desc, ep->maxPacketSize);
+				desc.push_back (0);
+			}
+			// wTotalLength
+			desc [2] = static_cast<unsigned char> (desc.size () & 0xFF);
+			desc [3] = static_cast<unsigned char> (desc.size () >> 8);
+			break;
+		}
+		case USB_DT_STRING:
+			if (index == 0) {
+				// Unterstützte Sprachen: nur Englisch (USA)
+				desc = { 0, USB_DT_STRING };
+				appendLe16 (desc, 0x0409);
+			} else if (index <= sizeof (gadgetStrings) / sizeof (gadgetStrings [0])) {
+				desc = { 0, USB_DT_STRING };
+				for (const char* c = gadgetStrings [index - 1]; *c; ++c)
+					appendLe16 (desc, static_cast<uint16_t> (*c));
+			} else {
+				ep0Stall ();
+				return;
+			}
+			break;
+		default:
+			ep0Stall ();
+			return;
+	}
+	if (type != USB_DT_CONFIG)
+		desc [0] = static_cast<unsigned char> (desc.size ());
+	ep0Write (setup, desc.data (), desc.size ());
+}
+
+void Gadget::configure () {
+	// Der Host kann die Konfiguration erneut setzen, die Endpoints bleiben dann bestehen
+	if (m_configured)
+		return;
+	for (GadgetEndpoint* ep : { &m_out, &m_in }) {
+		usb_endpoint_descriptor desc {};
+		desc.bLength = USB_DT_ENDPOINT_SIZE;
+		desc.bDescriptorType = USB_DT_ENDPOINT;
+		desc.bEndpointAddress = ep->address;
+		desc.bmAttributes = USB_ENDPOINT_XFER_BULK;
+		desc.wMaxPacketSize = htole16 (ep->maxPacketSize);
+		ep->handle = static_cast<uint16_t> (rawIoctl (m_fd, USB_RAW_IOCTL_EP_ENABLE, &desc, "Konnte Endpoint nicht aktivieren: "));
+	}
+	rawIoctl (m_fd, USB_RAW_IOCTL_VBUS_DRAW, reinterpret_cast<void*> (uintptr_t { 100 }), "Konnte Stromaufnahme nicht setzen: ");
+	rawIoctl (m_fd, USB_RAW_IOCTL_CONFIGURE, nullptr, "Konnte Gadget nicht konfigurieren: ");
+	m_configured = true;
+
+	m_echoThread = std::thread (&Gadget::echo, this);
+	if (!m_opts.command.empty ())
+		m_commandThread = std::thread (&Gadget::startCommand, this);
+	std::cout << "Gadget konfiguriert, Bulk-Endpoints: " << std::hex << int { m_out.address } << "/" << int { m_in.address } << std::dec
+				<< ", " << m_out.maxPacketSize << " Bytes pro Paket" << std::endl;
+}
+
+void Gadget::echo () {
+	// Verarbeite einzelne Pakete, damit kurze und Null-Pakete genau wie bei der Firmware zurückkommen
+	IoBuffer<usb_raw_ep_io> io;
+	const ReverseKernels& kernels = reverseKernels ();
+	try {
+		while (true) {
+			io.header ()->ep = m_out.handle;
+			io.header ()->flags = 0;
+			io.header ()->length = m_out.maxPacketSize;
+			const int length = rawIoctl (m_fd, USB_RAW_IOCTL_EP_READ, io.header (), "Bulk-OUT fehlgeschlagen: ");
+			kernels.reverse (io.data (), io.data (), static_cast<size_t> (length));
+			io.header ()->ep = m_in.handle;
+			io.header ()->length = static_cast<__u32> (length);
+			rawIoctl (m_fd, USB_RAW_IOCTL_EP_WRITE, io.header (), "Bulk-IN fehlgeschlagen: ");
+		}
+	} catch (const std::exception& e) {
+		std::cerr << e.what () << std::endl;
+	}
+}
+
+void Gadget::startCommand () {
+	std::this_thread::sleep_for (startDelay);
+	std::vector<char*> argv;
+	for (const std::string& arg : m_opts.command)
+		argv.push_back (const_cast<char*> (arg.c_str ()));
+	argv.push_back (nullptr);
+
+	const pid_t pid = fork ();
+	if (pid == 0) {
+		execvp (argv [0], argv.data ());
+		std::cerr << "Konnte " << argv [0] << " nicht ausführen: " << std::strerror (errno) << std::endl;
+		_exit (127);
+	}
+	int status = 0;
+	if (pid < 0 || waitpid (pid, &status, 0) < 0) {
+		std::cerr << "Konnte Befehl nicht ausführen: " << std::strerror (errno) << std::endl;
+		std::exit (1);
+	}
+	// Die übrigen Threads blockieren in ioctl-Aufrufen, daher endet das Programm hier
+	std::exit (WIFEXITED (status) ? WEXITSTATUS (status) : 1);
+}
+
+void Gadget::ep0Write (const usb_ctrlrequest& setup, const unsigned char* data, size_t length) {
+	IoBuffer<usb_raw_ep_io> io;
+	length = std::min ({ length, size_t { le16toh (setup.wLength) }, maxData });
+	io.header ()->ep = 0;
+	io.header ()->flags = 0;
+	io.header ()->length = static_cast<__u32> (length);
+	std::memcpy (io.data (), data, length);
+	rawIoctl (m_fd, USB_RAW_IOCTL_EP0_WRITE, io.header (), "Control-Antwort fehlgeschlagen: ");
+}
+
+void Gadget::ep0Ack () {
+	IoBuffer<usb_raw_ep_io> io;
+	io.header ()->ep = 0;
+	io.header ()->flags = 0;
+	io.header ()->length = 0;
+	rawIoctl (m_fd, USB_RAW_IOCTL_EP0_READ, io.header (), "Control-Bestätigung fehlgeschlagen: ");
+}
+
+void Gadget::ep0Stall () {
+	rawIoctl (m_fd, USB_RAW_IOCTL_EP0_STALL, nullptr, "Control-STALL fehlgeschlagen: ");
+}
+
+GadgetOptions parseOptions (const std::vector<std::string>& args) {
+	GadgetOptions opts;
+	for (size_t i = 1; i < args.size (); ++i) {
+		const std::string& arg = args [i];
+		// Liefert den auf die Option folgenden Wert
+		auto value = [&] () -> const std::string& {
+			if (i + 1 >= args.size ())
+				throw std::runtime_error ("Fehlender Wert für " + arg);
+			return args [++i];
+		};
+		if (arg == "--driver")
+			opts.driver = value ();
+		else if (arg == "--device")
+			opts.device = value ();
+		else if (arg == "--speed") {
+			const std::string& speed = value ();
+			if (speed == "full")
+				opts.speed = USB_SPEED_FULL;
+			else if (speed == "high")
+				opts.speed = USB_SPEED_HIGH;
+			else
+				throw std::runtime_error ("Ungültiger Wert für --speed: " + speed);
+		} else if (arg == "--") {
+			opts.command.assign (args.begin () + static_cast<std::ptrdiff_t> (i) + 1, args.end ());
+			break;
+		} else
+			throw std::runtime_error ("Aufruf: usbgadget [--driver NAME] [--device NAME] [--speed full|high] [-- BEFEHL ...]");
+	}
+	return opts;
+}
+
+}
+
+int main (int argc, char* argv []) {
+	try {
+		std::vector<std::string> args (argv, argv+argc);
+		GadgetOptions opts = parseOptions (args);
+		Gadget gadget (opts);
+		gadget.run ();
+		return 0;
+	} catch (const std::exception& e) {
+		std::cerr << e.what () << std::endl;
+		return 1;
+	}
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Liest eine mit "usbclient --record" erstellte Aufzeichnung und gibt die Einträge oder eine Zusammenfassung aus.
+ * Aufruf: usbrecord DATEI [--summary]
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "record.hh"
+#include "pattern.hh"
+#include "histogram.hh"
+
+namespace {
+
+/// Die über alle Einträge eines Endpoints zusammengefassten Werte
+struct EndpointSummary {
+	uint64_t transfers = 0, bytes = 0, failed = 0;
+	LatencyHistogram latency;
+};
+
+/// Gibt jeden Eintrag in einer Zeile aus
+void printRecords (RecordReader& reader) {
+	std::cout << "Nr. Zeitstempel(s) Endpoint Angefordert Länge Status Latenz(µs) CRC-32C Setup/Muster\n";
+	reader.forEach ([] (uint64_t n, const TransferRecord& record) {
+		char line [256];
+		int len = std::snprintf (line, sizeof (line), "%llu %llu.%09llu 0x%02x %u %u %d %.1f %08x", static_cast<unsigned long long> (n),
+				static_cast<unsigned long long> (record.timestamp / 1000000000u), static_cast<unsigned long long> (record.timestamp % 1000000000u),
+				unsigned { record.endpoint }, unsigned { record.requested }, unsigned { record.length }, int { record.status },
+				static_cast<double> (record.latency) / 1e3, unsigned { record.digest });
+		if ((record.endpoint & 0x7F) == 0)
+			// Control-Transfer: bmRequestType, bRequest, wValue, wIndex, wLength
+			len += std::snprintf (line + len, sizeof (line) - static_cast<size_t> (len), " %02x %02x %04x %04x %04x", unsigned { record.setup [0] }, unsigned { record.setup [1] },
+					unsigned { record.setup [2] } | (unsigned { record.setup [3] } << 8), unsigned { record.setup [4] } | (unsigned { record.setup [5] } << 8),
+					unsigned { record.setup [6] } | (unsigned { record.setup [7] } << 8));
+		else if (recordPatternValid (record.pattern))
+			len += std::snprintf (line + len, sizeof (line) - static_cast<size_t> (len), " %s/%llu@%llu",
+					patternName (static_cast<PatternType> (record.pattern - 1)), static_cast<unsigned long long> (record.seed),
+					static_cast<unsigned long long> (record.offset));
+		else if (record.pattern != recordNoPattern)
+			len += std::snprintf (line + len, sizeof (line) - static_cast<size_t> (len), " unbekanntes Muster %u", unsigned { record.pattern });
+		std::cout << line << "\n";
+	});
+}
+
+/// Gibt je Endpoint Anzahl, Bytes, Fehler und Latenzen aus
+void printSummary (RecordReader& reader) {
+	std::map<uint8_t, std::unique_ptr<EndpointSummary>> endpoints;
+	uint64_t firstTime = 0, lastTime = 0;
+	bool any = false;
+	reader.forEach ([&] (uint64_t, const TransferRecord& record) {
+		std::unique_ptr<EndpointSummary>& summary = endpoints [record.endpoint];
+		if (!summary)
+			summary.reset (new EndpointSummary);
+		++summary->transfers;
+		summary->bytes += record.length;
+		if (record.status != 0)
+			++summary->failed;
+		summary->latency.record (record.latency);
+
+		firstTime = any ? std::min (firstTime, record.timestamp) : record.timestamp;
+		lastTime = any ? std::max (lastTime, record.timestamp) : record.timestamp;
+		any = true;
+	});
+
+	std::cout	<< "Einträge: " << reader.count () << " von " << reader.header ().written << " geschriebenen (Kapazität "
+				<< reader.header ().capacity << ")\n";
+	if (any)
+		std::cout << "Zeitraum: " << static_cast<double> (lastTime - firstTime) / 1e9 << " s\n";
+	for (const auto& entry : endpoints) {
+		char name [16];
+		std::snprintf (name, sizeof (name), "0x%02x", unsigned { entry.first });
+		std::cout	<< "Endpoint " << name << ": " << entry.second->transfers << " Transfers, " << entry.second->bytes << " Bytes, "
+					<< entry.second->failed << " fehlgeschlagen\n";
+		entry.second->latency.printSummary (std::cout, name);
+	}
+}
+
+}
+
+int main (int argc, char* argv []) {
+	try {
+		std::vector<std::string> args (argv, argv+argc);
+		bool summary = false;
+		std::string path;
+		for (size_t i = 1; i < args.size (); ++i) {
+			if (args [i] == "--summary")
+				summary = true;
+			else if (args [i].compare (0, 2, "--") == 0 || !path.empty ())
+				throw std::runtime_error ("Unbekanntes Argument: " + args [i]);
+			else
+				path = args [i];
+		}
+		if (path.empty ())
+			throw std::runtime_error ("Aufruf: usbrecord DATEI [--summary]");
+
+		RecordReader reader (path);
+		if (summary)
+			printSummary (reader);
+		else
+			printRecords (reader);
+		std::cout.flush ();
+		return 0;
+	} catch (const std::exception& e) {
+		std::cerr << e.what () << std::endl;
+		return 1;
+	}
+}
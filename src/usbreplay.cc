@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Führt die mit "usbclient --record" aufgezeichneten Transfers erneut mit dem Gerät aus, wahlweise mit den ursprünglichen
+ * (ggf. beschleunigten) Abständen oder so schnell wie möglich, und meldet, wo Status, Länge oder Daten abweichen.
+ * Mit --sim wird statt des angeschlossenen Geräts das simulierte genutzt.
+ * Das Gerät lässt sich wie bei usbclient mit --vid, --pid, --path und --serial auswählen.
+ * Aufruf: usbreplay DATEI [--speed F] [--fast] [--max-gap S] [--timeout MS] [--sim] [--vid VID] [--pid PID] [--path PFAD] [--serial NR]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "libusb.h"
+#include "usb.hh"
+#include "device.hh"
+#include "simdevice.hh"
+#include "record.hh"
+#include "pattern.hh"
+#include "kernels.hh"
+#include "options.hh"
+
+namespace {
+
+/// Höchstzahl einzeln ausgegebener Abweichungen; weitere werden nur gezählt
+constexpr uint64_t maxReported = 20;
+
+/// Über die Kommandozeile einstellbare Optionen
+struct ReplayOptions {
+	/// Die Aufzeichnung
+	std::string path;
+	/// Faktor, um den die Abstände zwischen den Transfers verkürzt werden
+	double speed = 1;
+	/// Führe die Transfers ohne Pausen aus
+	bool fast = false;
+	/// Größter berücksichtigter Abstand zweier Transfers in Sekunden, damit Pausen zwischen fortgesetzten Aufzeichnungen nicht nachgestellt werden
+	double maxGap = 1;
+	/// Timeout jedes Transfers in Millisekunden; 0 für unbegrenzt
+	unsigned int timeout = 1000;
+	/// Nutze das simulierte Gerät (SimDevice)
+	bool sim = false;
+	/// Kriterien zur Auswahl des Geräts
+	DeviceSelector selector;
+};
+
+/// Das für den Vergleich relevante Ergebnis eines Transfers
+struct Outcome {
+	int32_t status;
+	uint32_t length;
+	uint32_t digest;
+};
+
+/// Liest einen 16-Bit-Wert im Little-Endian-Format, wie im Setup-Paket
+inline uint16_t readLe16 (const uint8_t* data) {
+	return static_cast<uint16_t> (data [0] | (data [1] << 8));
+}
+
+ReplayOptions parseOptions (const std::vector<std::string>& args) {
+	ReplayOptions opts;
+	for (size_t i = 1; i < args.size (); ++i) {
+		const std::string& arg = args [i];
+		// Liefert den auf die Option folgenden Wert
+		auto value = [&] () -> const std::string& {
+			if (i + 1 >= args.size ())
+				throw std::runtime_error ("Fehlender Wert für " + arg);
+			return args [++i];
+		};
+		if (arg == "--speed")
+			opts.speed = parseNumber (arg, value ());
+		else if (arg == "--fast")
+			opts.fast = true;
+		else if (arg == "--max-gap")
+			opts.maxGap = parseNumber (arg, value ());
+		else if (arg == "--timeout")
+			opts.timeout = parseUnsigned (arg, value ());
+		else if (arg == "--sim")
+			opts.sim = true;
+		else if (parseSelectorOption (args, i, opts.selector))
+			continue;
+		else if (arg.compare (0, 2, "--") == 0 || !opts.path.empty ())
+			throw std::runtime_error ("Unbekanntes Argument: " + arg);
+		else
+			opts.path = arg;
+	}
+	if (opts.path.empty ())
+		throw std::runtime_error ("Aufruf: usbreplay DATEI [--speed F] [--fast] [--max-gap S] [--timeout MS] [--sim] [--vid VID] [--pid PID] [--path PFAD] [--serial NR]");
+	return opts;
+}
+
+/**
+ * Führt den in "record" aufgezeichneten Transfer erneut aus. Gesendete Daten werden aus dem aufgezeichneten Pattern
+ * neu erzeugt; stammen sie nicht aus einem Pattern, werden Nullen gesendet. "buffer" wird bei Bedarf vergrößert.
+ */
+Outcome replayTransfer (Device& device, const TransferRecord& record, std::vector<unsigned char>& buffer, unsigned int timeout) {
+	if (buffer.size () < record.requested)
+		buffer.resize (record.requested);
+	unsigned char* data = buffer.data ();
+
+	if ((record.endpoint & LIBUSB_ENDPOINT_IN) == 0) {
+		if (record.pattern != recordNoPattern) {
+			if (!recordPatternValid (record.pattern))
+				throw std::runtime_error ("Unbekanntes Muster " + std::to_string (record.pattern) + " in der Aufzeichnung");
+			Pattern gen (static_cast<PatternType> (record.pattern - 1), record.seed);
+			gen.seek (record.offset);
+			gen.fill (data, record.requested);
+		} else
+			std::fill_n (data, record.requested, 0);
+	}
+
+	int res, transferred = 0;
+	if ((record.endpoint & LIBUSB_ENDPOINT_ADDRESS_MASK) == 0) {
+		res = device.controlTransfer (record.setup [0], record.setup [1], readLe16 (record.setup + 2), readLe16 (record.setup + 4),
+									data, readLe16 (record.setup + 6), timeout);
+		transferred = std::max (res, 0);
+	} else
+		res = device.bulkTransfer (record.endpoint, data, static_cast<int> (record.requested), transferred, timeout);
+
+	Outcome outcome;
+	outcome.status = std::min (res, 0);
+	outcome.length = static_cast<uint32_t> (transferred);
+	outcome.digest = transferred > 0 ? crc32c (0, data, static_cast<size_t> (transferred)) : 0;
+	return outcome;
+}
+
+/// Gibt die Abweichung des Transfers Nummer "n" in einer Zeile aus
+void printDifference (uint64_t n, const TransferRecord& record, const Outcome& outcome) {
+	char line [200];
+	std::snprintf (line, sizeof (line), "Abweichung bei Eintrag %llu (Endpoint 0x%02x): Status %s statt %s, Länge %u statt %u, CRC-32C %08x statt %08x\n",
+			static_cast<unsigned long long> (n), unsigned { record.endpoint }, libusb_error_name (outcome.status), libusb_error_name (record.status),
+			unsigned { outcome.length }, unsigned { record.length }, unsigned { outcome.digest }, unsigned { record.digest });
+	std::cout << line;
+}
+
+}
+
+int main (int argc, char* argv []) {
+	try {
+		std::vector<std::string> args (argv, argv+argc);
+		ReplayOptions opts = parseOptions (args);
+		RecordReader reader (opts.path);
+
+		// Der libusb Kontext in unique_ptr für automatische Freigabe; muss länger bestehen als das Gerät
+		CtxPtr ctxPtr;
+		std::unique_ptr<Device> device;
+		if (opts.sim)
+			device.reset (new SimDevice (SimConfig ()));
+		else {
+			// Initialisiere libusb
+			libusb_context* ctx;
+			lu_err (libusb_init (&ctx), "Initialisierung von libusb fehlgeschlagen: ");
+			ctxPtr.reset (ctx);
+			device = openLibusbDevice (ctx, std::cout, opts.selector);
+		}
+
+		std::vector<unsigned char> buffer;
+		uint64_t replayed = 0, differences = 0, lastTimestamp = 0;
+		double recordedSeconds = 0;
+		const auto start = std::chrono::steady_clock::now ();
+		auto next = start;
+		reader.forEach ([&] (uint64_t n, const TransferRecord& record) {
+			// Halte die Abstände der Transferbeginne ein, gemessen von Soll- zu Sollzeitpunkt, damit sich Verzögerungen nicht aufsummieren
+			if (replayed > 0) {
+				const double gap = std::min (record.timestamp > lastTimestamp ? static_cast<double> (record.timestamp - lastTimestamp) / 1e9 : 0.0, opts.maxGap);
+				recordedSeconds += gap;
+				next += std::chrono::duration_cast<std::chrono::steady_clock::duration> (std::chrono::duration<double> (gap / opts.speed));
+			}
+			lastTimestamp = record.timestamp;
+			if (!opts.fast)
+				std::this_thread::sleep_until (next);
+
+			const Outcome outcome = replayTransfer (*device, record, buffer, opts.timeout);
+			++replayed;
+			if (outcome.status != record.status || outcome.length != record.length || outcome.digest != record.digest) {
+				if (differences < maxReported)
+					printDifference (n, record, outcome);
+				++differences;
+			}
+		});
+
+		std::cout	<< std::dec << "Wiederholte Transfers: " << replayed << ", Abweichungen: " << differences << "\n"
+					<< "Dauer: " << std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count () << " s (aufgezeichnet: "
+					<< recordedSeconds << " s)" << std::endl;
+		return differences == 0 ? 0 : 1;
+	} catch (const std::exception& e) {
+		std::cerr << e.what () << std::endl;
+		return 1;
+	}
+}
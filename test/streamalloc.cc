@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Prüft, dass der Streaming-Modus nach dem Start ohne Heap-Allokationen läuft. Dazu wird der globale operator new
+ * durch einen ersetzt, der alle Aufrufe zählt, und streamHandling auf einem SimDevice ausgeführt. Nachdem die
+ * Pipeline angelaufen ist, darf sich der Zähler nicht mehr ändern, während weiter Blöcke übertragen werden.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <thread>
+#include "stream.hh"
+#include "simdevice.hh"
+#include "stats.hh"
+
+namespace {
+
+/// Anzahl aller Allokationen in allen Threads
+std::atomic<uint64_t> allocations (0);
+
+void* countedAlloc (size_t size) {
+	allocations.fetch_add (1, std::memory_order_relaxed);
+	return std::malloc (size == 0 ? 1 : size);
+}
+
+/// Wartet, bis "counters" mindestens "blocks" geprüfte Blöcke meldet
+void waitForBlocks (const StreamCounters& counters, uint64_t blocks) {
+	while (counters.transfers.get () < blocks)
+		std::this_thread::sleep_for (std::chrono::milliseconds (1));
+}
+
+}
+
+void* operator new (size_t size) {
+	void* ptr = countedAlloc (size);
+	if (!ptr)
+		throw std::bad_alloc ();
+	return ptr;
+}
+
+void* operator new [] (size_t size) {
+	return operator new (size);
+}
+
+void* operator new (size_t size, const std::nothrow_t&) noexcept {
+	return countedAlloc (size);
+}
+
+void* operator new [] (size_t size, const std::nothrow_t&) noexcept {
+	return countedAlloc (size);
+}
+
+void operator delete (void* ptr) noexcept {
+	std::free (ptr);
+}
+
+void operator delete [] (void* ptr) noexcept {
+	std::free (ptr);
+}
+
+void operator delete (void* ptr, size_t) noexcept {
+	std::free (ptr);
+}
+
+void operator delete [] (void* ptr, size_t) noexcept {
+	std::free (ptr);
+}
+
+int main () {
+	SimDevice device ((SimConfig ()));
+	StreamConfig config;
+	config.duration = 2;
+	config.transferSize = 1024;
+	StreamCounters counters;
+
+	StreamResult result;
+	std::thread worker ([&] () { result = streamHandling (device, config, counters); });
+
+	// Bis hier werden Pools, Warteschlangen und die Puffer des simulierten Geräts angelegt
+	waitForBlocks (counters, 1000);
+	const uint64_t allocBefore = allocations.load (), blocksBefore = counters.transfers.get ();
+	std::this_thread::sleep_for (std::chrono::milliseconds (500));
+	const uint64_t allocAfter = allocations.load (), blocksAfter = counters.transfers.get ();
+	worker.join ();
+
+	std::cout << "Blöcke im Messzeitraum: " << (blocksAfter - blocksBefore) << ", Allokationen: " << (allocAfter - allocBefore) << std::endl;
+	if (blocksAfter == blocksBefore) {
+		std::cout << "Fehler: Im Messzeitraum wurden keine Blöcke übertragen" << std::endl;
+		return 1;
+	}
+	if (allocAfter != allocBefore || result.mismatches != 0) {
+		std::cout << "Fehler: Der Streaming-Modus alloziert Speicher oder die Daten sind fehlerhaft" << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2017, Niklas Gürtler
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ *    disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ *    following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Belastungstest für den Streaming-Modus mit --steal: Mehrere SimDevices laufen per streamPooled in einem TaskPool
+ * mit mehr Workern, als es Geräte gibt, damit sich Worker die Aufgaben eines Geräts möglichst oft gegenseitig
+ * abnehmen. Die Läufe sind kurz und werden oft wiederholt, da die Übergabe am Ende eines Laufs am heikelsten ist:
+ * Dort darf eine Aufgabe erst freigegeben werden, wenn kein Worker und kein Event-Thread mehr auf sie zugreift.
+ * Fehler zeigen sich als Absturz, als fehlerhafte Daten oder, mit AddressSanitizer gebaut, als dessen Meldung.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "stream.hh"
+#include "simdevice.hh"
+#include "stats.hh"
+#include "taskpool.hh"
+
+namespace {
+
+/// Anzahl der simulierten Geräte
+constexpr size_t deviceCount = 4;
+
+/// Anzahl der Läufe
+constexpr unsigned int rounds = 100;
+
+}
+
+int main () {
+	std::vector<std::unique_ptr<SimDevice>> devices;
+	for (size_t i = 0; i < deviceCount; ++i)
+		devices.emplace_back (new SimDevice (SimConfig ()));
+	// Die Worker müssen nicht an verschiedene Kerne gebunden sein, um sich zu überschneiden
+	const unsigned int cpus = std::max (std::thread::hardware_concurrency (), 1u);
+	std::vector<unsigned int> workers;
+	for (unsigned int i = 0; i < 2 * deviceCount; ++i)
+		workers.push_back (i % cpus);
+	TaskPool pool (workers);
+
+	uint64_t blocks = 0;
+	for (unsigned int r = 0; r < rounds; ++r) {
+		std::unique_ptr<StreamCounters []> counters (new StreamCounters [deviceCount]);
+		std::vector<ShardStream> streams (deviceCount);
+		for (size_t i = 0; i < deviceCount; ++i) {
+			streams [i].device = devices [i].get ();
+			streams [i].config.duration = 0.01;
+			streams [i].config.transferSize = 64;
+			streams [i].counters = &counters [i];
+			streams [i].worker = static_cast<unsigned int> (i);
+		}
+		streamPooled (streams, pool);
+		for (size_t i = 0; i < deviceCount; ++i) {
+			if (!streams [i].error.empty () || counters [i].mismatches.get () != 0) {
+				std::cout << "Fehler in Lauf " << r << " auf Gerät " << i << ": "
+					<< (streams [i].error.empty () ? "fehlerhafte Daten" : streams [i].error) << std::endl;
+				return 1;
+			}
+			blocks += counters [i].transfers.get ();
+		}
+	}
+	std::cout << "Läufe: " << rounds << ", Blöcke: " << blocks << ", gestohlene Aufgaben: " << pool.steals () << std::endl;
+	if (blocks == 0) {
+		std::cout << "Fehler: Es wurden keine Blöcke übertragen" << std::endl;
+		return 1;
+	}
+	return 0;
+}